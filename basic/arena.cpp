@@ -0,0 +1,71 @@
+#include <arena.h>
+#include "object.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace {
+
+thread_local ParseArena* current_arena = nullptr;
+
+constexpr size_t kMaxChunkSize = 1 << 20;
+
+}  // namespace
+
+ParseArena::ParseArena() : chunks_(new Chunks()) {
+}
+
+ParseArena::~ParseArena() {
+    chunks_->Unref();
+}
+
+ParseArena::Scope::Scope(ParseArena& arena) : previous_(current_arena) {
+    current_arena = &arena;
+}
+
+ParseArena::Scope::~Scope() {
+    current_arena = previous_;
+}
+
+ParseArena* ParseArena::Current() {
+    return current_arena;
+}
+
+size_t ParseArena::BytesAllocated() const {
+    return chunks_->BytesAllocated();
+}
+
+size_t ParseArena::LiveNodes() const {
+    return chunks_->Refs() - 1;
+}
+
+void* ParseArena::Chunks::Allocate(size_t size, size_t alignment) {
+    size_t padding = -reinterpret_cast<uintptr_t>(next_) & (alignment - 1);
+    if (static_cast<size_t>(end_ - next_) < size + padding) {
+        // Chunks grow geometrically, so small parses stay small and large
+        // ones need few chunks.
+        size_t chunk_size = std::max(next_chunk_size_, size + alignment);
+        next_chunk_size_ = std::min(next_chunk_size_ * 2, kMaxChunkSize);
+        next_ = static_cast<char*>(::operator new(chunk_size));
+        end_ = next_ + chunk_size;
+        chunks_.push_back(next_);
+        padding = -reinterpret_cast<uintptr_t>(next_) & (alignment - 1);
+    }
+    char* result = next_ + padding;
+    next_ = result + size;
+    bytes_allocated_ += size + padding;
+    return result;
+}
+
+ParseArena::Chunks::~Chunks() {
+    for (char* chunk : chunks_) {
+        ::operator delete(chunk);
+    }
+}
+
+void ParseArena::Delete(Object* object) {
+    Chunks* chunks = *reinterpret_cast<Chunks**>(reinterpret_cast<char*>(object) - sizeof(Chunks*));
+    object->~Object();
+    chunks->Unref();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+class Object;
+
+// A bump allocator for the nodes of one parse. Nodes are ordinary Objects
+// behind a Ref; each one is preceded by a pointer back to its chunks, which
+// is all Object::Release needs to destroy it in place.
+//
+// Freeing a node only drops a reference: the chunks are returned together
+// once the ParseArena and every node allocated from it are gone. A node may
+// therefore safely outlive the ParseArena handle, even on another thread.
+class ParseArena {
+public:
+    ParseArena();
+    ~ParseArena();
+
+    ParseArena(const ParseArena&) = delete;
+    ParseArena& operator=(const ParseArena&) = delete;
+
+    // Makes the arena the current one for this thread while it is alive, so
+    // the object factory allocates nodes from it.
+    class Scope {
+    public:
+        explicit Scope(ParseArena& arena);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        ParseArena* previous_;
+    };
+
+    static ParseArena* Current();
+
+    size_t BytesAllocated() const;
+    size_t LiveNodes() const;
+
+    class Chunks;
+
+    // Creates a T in the arena, without references yet.
+    template <class T, class... Args>
+    T* New(Args&&... args);
+
+    // Destroys an object made by New. Only Object::Release calls it.
+    static void Delete(Object* object);
+
+private:
+    Chunks* chunks_;
+};
+
+// The storage behind a ParseArena. It deletes itself when the last reference,
+// from the handle or from a live node, is dropped.
+class ParseArena::Chunks {
+public:
+    void* Allocate(size_t size, size_t alignment);
+
+    void Ref() {
+        refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Unref() {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    size_t BytesAllocated() const {
+        return bytes_allocated_;
+    }
+
+    size_t Refs() const {
+        return refs_.load(std::memory_order_relaxed);
+    }
+
+    ~Chunks();
+
+private:
+    std::vector<char*> chunks_;
+    char* next_ = nullptr;
+    char* end_ = nullptr;
+    size_t next_chunk_size_ = 4096;
+    size_t bytes_allocated_ = 0;
+    std::atomic<size_t> refs_{1};
+};
+
+template <class T, class... Args>
+T* ParseArena::New(Args&&... args) {
+    static_assert(alignof(T) <= sizeof(Chunks*));
+    char* memory = static_cast<char*>(chunks_->Allocate(sizeof(Chunks*) + sizeof(T), sizeof(Chunks*)));
+    *reinterpret_cast<Chunks**>(memory) = chunks_;
+    T* object = new (memory + sizeof(Chunks*)) T(std::forward<Args>(args)...);
+    chunks_->Ref();
+    object->in_arena_ = true;
+    return object;
+}
@@ -0,0 +1,89 @@
+// Allocation-heavy workloads: building and dropping lists outside a parse
+// arena, and evaluating programs that cons.
+//
+//   bench_cons [rounds]
+
+#include <object_factory.h>
+#include <parser.h>
+#include <scheme.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+template <class F>
+double Seconds(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PrintOccupancy(const char* name, ObjectType type) {
+    SlabStats stats = SlabPool::Stats(type);
+    std::cout << "  " << name << ": " << stats.slot_size << "-byte slots, " << stats.slabs
+              << " slabs, " << stats.Live() << " live of " << stats.capacity << " ("
+              << stats.Occupancy() * 100 << "%), " << stats.allocations << " allocations\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t rounds = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20;
+
+    // Lists of 100000 numbers made through the object factory and dropped.
+    double build = Seconds([&] {
+        for (size_t round = 0; round < rounds; ++round) {
+            Ref<Object> list;
+            for (int64_t i = 0; i < 100000; ++i) {
+                list = MakeCell(MakeNumber(i), std::move(list));
+            }
+        }
+    });
+    std::cout << "build and drop: " << build / rounds * 1000 << " ms per 100000 cells\n";
+
+    // A quoted literal read onto the heap, as without a ParseArena.
+    std::string literal = "'(";
+    for (int i = 0; i < 20000; ++i) {
+        literal += "(item " + std::to_string(i) + " . tail) ";
+    }
+    literal += ")";
+    double read = Seconds([&] {
+        for (size_t round = 0; round < rounds; ++round) {
+            Tokenizer tokenizer{std::string_view{literal}, false};
+            Read(&tokenizer);
+        }
+    });
+    std::cout << "read and drop: " << read / rounds * 1000 << " ms per " << literal.size()
+              << " bytes\n";
+
+    // The evaluator: every cons makes a cell and turns its operands into
+    // numbers.
+    Interpreter interpreter;
+    interpreter.SetParseCacheCapacity(16);
+    std::string list = "(list";
+    for (int i = 0; i < 300; ++i) {
+        list += " " + std::to_string(i);
+    }
+    list += ")";
+    double evaluate = Seconds([&] {
+        for (size_t round = 0; round < rounds * 100; ++round) {
+            interpreter.Run(list);
+        }
+    });
+    double cons = Seconds([&] {
+        for (size_t round = 0; round < rounds * 10000; ++round) {
+            interpreter.Run("(cons 1 (cons 2 (cons 3 '())))");
+        }
+    });
+    std::cout << "(list ...) of 300: " << evaluate / (rounds * 100) * 1e6 << " us, "
+              << "three conses: " << cons / (rounds * 10000) * 1e6 << " us\n";
+
+    std::cout << "slab occupancy on this thread:\n";
+    PrintOccupancy("numbers", ObjectType::NUMBER);
+    PrintOccupancy("symbols", ObjectType::SYMBOL);
+    PrintOccupancy("cells", ObjectType::CELL);
+    return 0;
+}
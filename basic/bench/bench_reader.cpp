@@ -0,0 +1,133 @@
+// Reader throughput on a file of many independent top-level forms.
+//
+//   bench_reader [megabytes]
+
+#include <arena.h>
+#include <parallel_reader.h>
+#include <parser.h>
+#include <scmb.h>
+#include <structural_reader.h>
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+
+namespace {
+
+std::string GenerateSource(size_t bytes) {
+    std::default_random_engine rng{42};
+    std::uniform_int_distribution<int> value(-100000, 100000);
+    std::string source;
+    source.reserve(bytes + 256);
+    while (source.size() < bytes) {
+        source += "(define-record ";
+        source += std::to_string(value(rng));
+        source += " 'field-name (nested (list ";
+        source += std::to_string(value(rng));
+        source += " item? #t) . tail))\n";
+    }
+    return source;
+}
+
+// Heap bytes in use, including chunks the allocator maps directly.
+size_t HeapInUse() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+template <class F>
+double Seconds(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    std::string source = GenerateSource(megabytes << 20);
+
+    size_t forms = 0;
+    double split = Seconds([&] { forms = SplitTopLevel(source).size(); });
+    std::cout << "pre-scan: " << forms << " forms, " << source.size() / split / 1e6 << " MB/s\n";
+
+    // One big quoted data literal: token-at-a-time Read against both stages.
+    // The best of a few rounds, with the nodes released outside the timed
+    // part, so neither side pays for growing the slabs the other reuses.
+    std::string literal = "'(" + source + ")";
+    double index = Seconds([&] { BuildStructuralIndex(literal); });
+    double structural = 1e9;
+    double read = 1e9;
+    for (int round = 0; round < 3; ++round) {
+        std::vector<Ref<Object>> data;
+        structural = std::min(structural, Seconds([&] { data = ReadStructural(literal); }));
+        data.clear();
+        Ref<Object> datum;
+        read = std::min(read, Seconds([&] {
+                            Tokenizer tokenizer{std::string_view{literal}, false};
+                            datum = Read(&tokenizer);
+                        }));
+    }
+    // ReadStructural is not a drop-in for Read, which nests lists differently;
+    // see structural_reader.h.
+    std::cout << "stage one: " << literal.size() / index / 1e6 << " MB/s\n"
+              << "structural (standalone): " << structural * 1000 << " ms, Read: " << read * 1000
+              << " ms, speedup " << read / structural << "\n";
+
+    // The same literal parsed onto the global heap and into a parse arena.
+    for (bool use_arena : {false, true}) {
+        size_t heap_before = HeapInUse();
+        Ref<Object> datum;
+        ParseArena arena;
+        double parse = Seconds([&] {
+            std::optional<ParseArena::Scope> scope;
+            if (use_arena) {
+                scope.emplace(arena);
+            }
+            Tokenizer tokenizer{std::string_view{literal}, false};
+            datum = Read(&tokenizer);
+        });
+        size_t heap = HeapInUse() - heap_before;
+        double release = Seconds([&] { datum.reset(); });
+        std::cout << (use_arena ? "arena: " : "heap: ") << "parse " << parse * 1000
+                  << " ms, release " << release * 1000 << " ms, " << heap / (1 << 20)
+                  << " MiB\n";
+    }
+
+    // Parsing the file against loading it precompiled.
+    {
+        const std::string path = "/tmp/bench_reader.scmb";
+        FlatAst ast;
+        double parse = Seconds([&] {
+            for (const Ref<Object>& datum : ReadAllParallel(source, 1)) {
+                ast.Append(datum);
+            }
+        });
+        WriteScmb(ast.View(), path);
+        size_t nodes = 0;
+        double load = Seconds([&] { nodes = ScmbFile{path}.View().Size(); });
+        std::remove(path.c_str());
+        std::cout << "parse and flatten: " << parse * 1000 << " ms, .scmb load: " << load * 1000
+                  << " ms for " << nodes << " nodes\n";
+    }
+
+    double single = 0;
+    for (size_t threads : {1, 2, 4, 8}) {
+        double elapsed = Seconds([&] { ReadAllParallel(source, threads); });
+        if (threads == 1) {
+            single = elapsed;
+        }
+        std::cout << threads << " threads: " << elapsed * 1000 << " ms, "
+                  << source.size() / elapsed / 1e6 << " MB/s, speedup " << single / elapsed
+                  << "\n";
+    }
+    return 0;
+}
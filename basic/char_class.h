@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+
+// Character classes used by the tokenizer, one table lookup per character
+// instead of locale-aware <cctype> calls. Bytes outside ASCII belong to no class.
+enum CharClass : uint8_t {
+    kSpace = 1 << 0,        // ' ', \t, \n, \v, \f, \r
+    kDigit = 1 << 1,        // 0-9
+    kSymbolStart = 1 << 2,  // may begin a symbol
+    kSymbolChar = 1 << 3,   // may continue a symbol
+    kDelimiter = 1 << 4,    // may directly follow a number or a symbol
+};
+
+constexpr std::array<uint8_t, 256> MakeCharClassTable() {
+    std::array<uint8_t, 256> table{};
+    for (int c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+        table[c] |= kSpace | kDelimiter;
+    }
+    for (int c = '0'; c <= '9'; ++c) {
+        table[c] |= kDigit | kSymbolChar | kDelimiter;
+    }
+    for (int c = 'a'; c <= 'z'; ++c) {
+        table[c] |= kSymbolStart | kSymbolChar | kDelimiter;
+        table[c - 'a' + 'A'] |= kSymbolStart | kSymbolChar | kDelimiter;
+    }
+    for (int c : {'<', '=', '>', '*', '#', '/'}) {
+        table[c] |= kSymbolStart | kSymbolChar | kDelimiter;
+    }
+    for (int c : {'-', '!', '?'}) {
+        table[c] |= kSymbolChar | kDelimiter;
+    }
+    for (int c : {'(', ')', '.', '+'}) {
+        table[c] |= kDelimiter;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint8_t, 256> kCharClass = MakeCharClassTable();
+
+// c is a character as returned by std::istream::get(): 0..255 or EOF.
+inline bool HasClass(int c, uint8_t cls) {
+    return c != EOF && (kCharClass[c] & cls);
+}
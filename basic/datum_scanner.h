@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "char_class.h"
+#include "scan.h"
+
+// Finds where top-level data end without tokenizing them: it only follows
+// paren depth, atoms and quote prefixes. The state carries over from one
+// Scan() to the next, so input may be split anywhere, even inside an atom.
+class DatumScanner {
+public:
+    // Scans text[from, text.size()) and calls on_end(i) with the index just
+    // past every datum that ends in it.
+    template <class OnEnd>
+    void Scan(std::string_view text, size_t from, OnEnd&& on_end) {
+        const char* begin = text.data();
+        const char* end = begin + text.size();
+        for (const char* p = begin + from; p != end; ++p) {
+            if (in_atom_) {
+                const char* next = SkipSymbolChars(p, end);
+                if (next != p) {
+                    atom_is_quotes_ = false;
+                    p = next;
+                    if (p == end) {
+                        break;
+                    }
+                }
+            } else {
+                p = SkipSpaces(p, end);
+                if (p == end) {
+                    break;
+                }
+            }
+            char c = *p;
+            bool is_space = HasClass(static_cast<unsigned char>(c), kSpace);
+            if (in_atom_) {
+                if (!is_space && c != '(' && c != ')') {
+                    atom_is_quotes_ = atom_is_quotes_ && c == '\'';
+                    continue;
+                }
+                in_atom_ = false;
+                // A run of quotes still waits for the datum it quotes.
+                if (depth_ == 0 && !atom_is_quotes_) {
+                    EndDatum(p - begin, on_end);
+                }
+            }
+            if (is_space) {
+                continue;
+            }
+            has_content_ = true;
+            if (c == '(') {
+                ++depth_;
+            } else if (c == ')') {
+                // A stray ')' at the top level ends a datum the parser will reject.
+                if (depth_ == 0 || --depth_ == 0) {
+                    EndDatum(p + 1 - begin, on_end);
+                }
+            } else {
+                in_atom_ = true;
+                atom_is_quotes_ = c == '\'';
+            }
+        }
+    }
+
+    // The input is over. Returns true if it ends with a datum that is still
+    // open: a trailing atom, or something unfinished for the parser to reject.
+    bool Finish() {
+        bool has_content = has_content_;
+        *this = DatumScanner{};
+        return has_content;
+    }
+
+private:
+    template <class OnEnd>
+    void EndDatum(size_t end, OnEnd& on_end) {
+        has_content_ = false;
+        on_end(end);
+    }
+
+    size_t depth_ = 0;
+    bool in_atom_ = false;
+    bool atom_is_quotes_ = false;
+    bool has_content_ = false;
+};
@@ -0,0 +1,215 @@
+#include <flat_ast.h>
+#include "object_factory.h"
+
+uint32_t FlatAst::Add(NodeKind kind, int64_t payload) {
+    if (kinds_.size() == kNone) {
+        throw RuntimeError{"too many nodes"};
+    }
+    uint32_t node = kinds_.size();
+    kinds_.push_back(kind);
+    first_child_.push_back(kNone);
+    next_sibling_.push_back(kNone);
+    payload_.push_back(payload);
+    if (open_.empty()) {
+        if (!roots_.empty()) {
+            next_sibling_[roots_.back()] = node;
+        }
+        roots_.push_back(node);
+        return node;
+    }
+    OpenNode& parent = open_.back();
+    if (parent.last_child == kNone) {
+        first_child_[parent.node] = node;
+    } else {
+        next_sibling_[parent.last_child] = node;
+    }
+    parent.last_child = node;
+    return node;
+}
+
+uint32_t FlatAst::AddInteger(int64_t value) {
+    return Add(NodeKind::INTEGER, value);
+}
+
+uint32_t FlatAst::AddSymbol(std::string_view name) {
+    return Add(NodeKind::SYMBOL, symbols_.InternCopy(name));
+}
+
+uint32_t FlatAst::Open(NodeKind kind) {
+    uint32_t node = Add(kind, 0);
+    open_.push_back({node});
+    return node;
+}
+
+void FlatAst::MarkDotted() {
+    kinds_[open_.back().node] = NodeKind::DOTTED_LIST;
+}
+
+void FlatAst::Close() {
+    open_.pop_back();
+}
+
+void FlatAst::Clear() {
+    kinds_.clear();
+    first_child_.clear();
+    next_sibling_.clear();
+    payload_.clear();
+    symbols_.Clear();
+    roots_.clear();
+    open_.clear();
+}
+
+uint32_t FlatAstView::SubtreeEnd(uint32_t node) const {
+    uint32_t last = node;
+    while (first_child_[last] != kNone) {
+        last = first_child_[last];
+        while (next_sibling_[last] != kNone) {
+            last = next_sibling_[last];
+        }
+    }
+    return last + 1;
+}
+
+Ref<Object> FlatAstView::ToObject(uint32_t node) const {
+    // Walking the range backwards finishes every child before its parent, and
+    // leaves a parent's children on the stack with the first one on top.
+    std::vector<Ref<Object>> values;
+    for (uint32_t i = SubtreeEnd(node); i-- > node;) {
+        NodeKind kind = kinds_[i];
+        if (kind == NodeKind::INTEGER) {
+            values.push_back(MakeNumber(payload_[i]));
+            continue;
+        }
+        if (kind == NodeKind::SYMBOL) {
+            values.push_back(MakeSymbol(GetName(i)));
+            continue;
+        }
+        if (kind == NodeKind::QUOTE) {
+            values.back() = MakeCell(MakeSymbol("quote"), std::move(values.back()));
+            continue;
+        }
+        size_t children = 0;
+        for (uint32_t child = first_child_[i]; child != kNone; child = next_sibling_[child]) {
+            ++children;
+        }
+        size_t elements = children - (kind == NodeKind::DOTTED_LIST);
+        Ref<Object> list;
+        Cell* last = nullptr;
+        for (size_t j = 0; j < elements; ++j) {
+            Ref<Object> cell = MakeCell(std::move(values.back()), nullptr);
+            values.pop_back();
+            Cell* appended = static_cast<Cell*>(cell.get());
+            if (last) {
+                last->SetSecond(std::move(cell));
+            } else {
+                list = std::move(cell);
+            }
+            last = appended;
+        }
+        if (kind == NodeKind::DOTTED_LIST) {
+            last->SetSecond(std::move(values.back()));
+            values.pop_back();
+        }
+        values.push_back(std::move(list));
+    }
+    return std::move(values.back());
+}
+
+std::string FlatAstView::Serialize(uint32_t node) const {
+    // Text to emit, then the node to print after it, if any.
+    struct Pending {
+        std::string_view text;
+        uint32_t node;
+    };
+    std::string result;
+    std::vector<Pending> stack{{"", node}};
+    std::vector<uint32_t> children;
+    while (!stack.empty()) {
+        Pending pending = stack.back();
+        stack.pop_back();
+        result += pending.text;
+        if (pending.node == kNone) {
+            continue;
+        }
+        uint32_t current = pending.node;
+        NodeKind kind = kinds_[current];
+        if (kind == NodeKind::INTEGER) {
+            result += std::to_string(payload_[current]);
+        } else if (kind == NodeKind::SYMBOL) {
+            result += GetName(current);
+        } else if (kind == NodeKind::QUOTE) {
+            result += '\'';
+            stack.push_back({"", first_child_[current]});
+        } else {
+            result += '(';
+            stack.push_back({")", kNone});
+            children.clear();
+            for (uint32_t child = first_child_[current]; child != kNone;
+                 child = next_sibling_[child]) {
+                children.push_back(child);
+            }
+            for (size_t j = children.size(); j-- > 0;) {
+                std::string_view separator = j == 0 ? "" : " ";
+                if (kind == NodeKind::DOTTED_LIST && j + 1 == children.size()) {
+                    separator = " . ";
+                }
+                stack.push_back({separator, children[j]});
+            }
+        }
+    }
+    return result;
+}
+
+uint32_t FlatAst::Append(const Ref<Object>& datum) {
+    // Either a datum to add, or the end of the list opened before it.
+    struct Pending {
+        Object* object;
+        bool close;
+    };
+    uint32_t root = Size();
+    std::vector<Pending> stack{{datum.get(), false}};
+    std::vector<Object*> elements;
+    while (!stack.empty()) {
+        Pending pending = stack.back();
+        stack.pop_back();
+        if (pending.close) {
+            Close();
+            continue;
+        }
+        Object* object = pending.object;
+        if (!object) {
+            Open(NodeKind::LIST);
+            Close();
+            continue;
+        }
+        switch (object->Type()) {
+            case ObjectType::NUMBER:
+                AddInteger(static_cast<Number*>(object)->GetValue());
+                break;
+            case ObjectType::SYMBOL:
+                AddSymbol(static_cast<Symbol*>(object)->GetName());
+                break;
+            case ObjectType::CELL: {
+                elements.clear();
+                Object* rest = object;
+                while (rest && rest->Type() == ObjectType::CELL) {
+                    Cell* pair = static_cast<Cell*>(rest);
+                    elements.push_back(pair->GetFirst().get());
+                    rest = pair->GetSecond().get();
+                }
+                Open(rest ? NodeKind::DOTTED_LIST : NodeKind::LIST);
+                stack.push_back({nullptr, true});
+                if (rest) {
+                    stack.push_back({rest, false});
+                }
+                for (size_t j = elements.size(); j-- > 0;) {
+                    stack.push_back({elements[j], false});
+                }
+                break;
+            }
+            default:
+                throw RuntimeError{"only data can be flattened"};
+        }
+    }
+    return root;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "object.h"
+#include "tokenizer.h"
+
+enum class NodeKind : uint8_t { INTEGER, SYMBOL, LIST, DOTTED_LIST, QUOTE };
+
+// Read-only access to a flat tree whose arrays live elsewhere: in a FlatAst
+// or in a mapped .scmb file. See FlatAst for the layout.
+class FlatAstView {
+public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    FlatAstView() = default;
+
+    FlatAstView(size_t size, const NodeKind* kinds, const uint32_t* first_child,
+                const uint32_t* next_sibling, const int64_t* payload,
+                std::span<const uint32_t> roots, std::span<const std::string_view> names)
+        : size_(size),
+          kinds_(kinds),
+          first_child_(first_child),
+          next_sibling_(next_sibling),
+          payload_(payload),
+          roots_(roots),
+          names_(names){};
+
+    size_t Size() const {
+        return size_;
+    }
+
+    NodeKind Kind(uint32_t node) const {
+        return kinds_[node];
+    }
+
+    uint32_t FirstChild(uint32_t node) const {
+        return first_child_[node];
+    }
+
+    uint32_t NextSibling(uint32_t node) const {
+        return next_sibling_[node];
+    }
+
+    int64_t GetInteger(uint32_t node) const {
+        return payload_[node];
+    }
+
+    std::string_view GetName(uint32_t node) const {
+        return names_[payload_[node]];
+    }
+
+    std::span<const uint32_t> Roots() const {
+        return roots_;
+    }
+
+    // Symbol names by id.
+    std::span<const std::string_view> Names() const {
+        return names_;
+    }
+
+    const NodeKind* Kinds() const {
+        return kinds_;
+    }
+    const uint32_t* FirstChildren() const {
+        return first_child_;
+    }
+    const uint32_t* NextSiblings() const {
+        return next_sibling_;
+    }
+    const int64_t* Payloads() const {
+        return payload_;
+    }
+
+    // One past the last node of the subtree rooted at node.
+    uint32_t SubtreeEnd(uint32_t node) const;
+
+    // Builds the equivalent Cell tree; a QUOTE becomes Cell(quote, datum).
+    Ref<Object> ToObject(uint32_t node) const;
+
+    // Standard external representation, with 'x for quotes.
+    std::string Serialize(uint32_t node) const;
+
+private:
+    size_t size_ = 0;
+    const NodeKind* kinds_ = nullptr;
+    const uint32_t* first_child_ = nullptr;
+    const uint32_t* next_sibling_ = nullptr;
+    const int64_t* payload_ = nullptr;
+    std::span<const uint32_t> roots_;
+    std::span<const std::string_view> names_;
+};
+
+// A syntax tree stored as parallel arrays indexed by node id instead of as
+// linked Cells.
+//
+// Nodes are numbered in preorder, so a node's first child, when it has one, is
+// the next node, and every subtree is a contiguous range of ids. A plain loop
+// from 0 to Size() visits the whole program in source order and only ever
+// reads memory sequentially.
+//
+// LIST children are the elements. DOTTED_LIST children are the elements and
+// then the tail. QUOTE has exactly one child. The empty list is a LIST without
+// children. The payload is the value of an INTEGER and the symbol id of a
+// SYMBOL.
+class FlatAst {
+public:
+    static constexpr uint32_t kNone = FlatAstView::kNone;
+
+    FlatAst() = default;
+    FlatAst(FlatAst&&) = default;
+    FlatAst& operator=(FlatAst&&) = default;
+
+    size_t Size() const {
+        return kinds_.size();
+    }
+
+    NodeKind Kind(uint32_t node) const {
+        return kinds_[node];
+    }
+
+    uint32_t FirstChild(uint32_t node) const {
+        return first_child_[node];
+    }
+
+    uint32_t NextSibling(uint32_t node) const {
+        return next_sibling_[node];
+    }
+
+    int64_t GetInteger(uint32_t node) const {
+        return payload_[node];
+    }
+
+    std::string_view GetName(uint32_t node) const {
+        return symbols_.Name(payload_[node]);
+    }
+
+    const SymbolTable& GetSymbols() const {
+        return symbols_;
+    }
+
+    // Top-level data in source order. They are also linked as siblings.
+    const std::vector<uint32_t>& Roots() const {
+        return roots_;
+    }
+
+    // Valid until the next node is added.
+    FlatAstView View() const {
+        return FlatAstView(kinds_.size(), kinds_.data(), first_child_.data(),
+                           next_sibling_.data(), payload_.data(), roots_, symbols_.Names());
+    }
+
+    uint32_t SubtreeEnd(uint32_t node) const {
+        return View().SubtreeEnd(node);
+    }
+
+    Ref<Object> ToObject(uint32_t node) const {
+        return View().ToObject(node);
+    }
+
+    std::string Serialize(uint32_t node) const {
+        return View().Serialize(node);
+    }
+
+    // Building, in preorder. Each node is appended as the next child of the
+    // innermost open node, or as a new root when none is open.
+    uint32_t AddInteger(int64_t value);
+    uint32_t AddSymbol(std::string_view name);
+    uint32_t Open(NodeKind kind);
+    // Turns the innermost open LIST into a DOTTED_LIST; its last child will
+    // be the tail.
+    void MarkDotted();
+    void Close();
+
+    // Appends a Cell tree as a new root. Cells that form a proper list become
+    // a LIST and other pairs a DOTTED_LIST, so Read's output flattens as is.
+    uint32_t Append(const Ref<Object>& datum);
+
+    void Clear();
+
+private:
+    struct OpenNode {
+        uint32_t node;
+        uint32_t last_child = kNone;
+    };
+
+    uint32_t Add(NodeKind kind, int64_t payload);
+
+    std::vector<NodeKind> kinds_;
+    std::vector<uint32_t> first_child_;
+    std::vector<uint32_t> next_sibling_;
+    std::vector<int64_t> payload_;
+    SymbolTable symbols_;
+    std::vector<uint32_t> roots_;
+    std::vector<OpenNode> open_;
+};
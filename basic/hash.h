@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// A fast non-cryptographic 64-bit hash in the style of wyhash: the input is
+// consumed 16 bytes at a time, each step folded in with one 64x64->128-bit
+// multiply. Good for hash tables, useless against an adversary.
+
+namespace hash_detail {
+
+constexpr uint64_t kSecret[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+                                 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+
+inline uint64_t Mix(uint64_t a, uint64_t b) {
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+
+inline uint64_t Load(const char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+}  // namespace hash_detail
+
+inline uint64_t HashBytes(std::string_view data) {
+    using namespace hash_detail;
+    const char* p = data.data();
+    size_t left = data.size();
+    uint64_t h = kSecret[0];
+    while (left > 16) {
+        h = Mix(Load(p) ^ kSecret[1], Load(p + 8) ^ h);
+        p += 16;
+        left -= 16;
+    }
+    char tail[16] = {};
+    std::memcpy(tail, p, left);
+    h = Mix(Load(tail) ^ kSecret[1], Load(tail + 8) ^ h);
+    return Mix(h ^ kSecret[2], data.size() ^ kSecret[3]);
+}
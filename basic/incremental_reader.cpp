@@ -0,0 +1,54 @@
+#include <incremental_reader.h>
+#include "parser.h"
+
+void IncrementalReader::Feed(std::string_view chunk) {
+    if (finished_) {
+        throw RuntimeError{"input already finished"};
+    }
+    Compact();
+    size_t from = buffer_.size();
+    buffer_.append(chunk);
+    scanner_.Scan(buffer_, from, [this](size_t end) { datum_ends_.push_back(end); });
+}
+
+void IncrementalReader::Finish() {
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+    if (scanner_.Finish()) {
+        datum_ends_.push_back(buffer_.size());
+    }
+}
+
+std::optional<std::string_view> IncrementalReader::TryReadSource() {
+    if (datum_ends_.empty()) {
+        return std::nullopt;
+    }
+    size_t begin = consumed_;
+    consumed_ = datum_ends_.front();
+    datum_ends_.pop_front();
+    return std::string_view{buffer_}.substr(begin, consumed_ - begin);
+}
+
+std::optional<Ref<Object>> IncrementalReader::TryReadDatum() {
+    std::optional<std::string_view> source = TryReadSource();
+    if (!source) {
+        return std::nullopt;
+    }
+    Tokenizer tokenizer{*source, false};
+    return Read(&tokenizer);
+}
+
+void IncrementalReader::Compact() {
+    // Drop consumed input once it is at least half of the buffer, so every
+    // byte is moved O(1) times on average.
+    if (consumed_ == 0 || consumed_ < buffer_.size() - consumed_) {
+        return;
+    }
+    buffer_.erase(0, consumed_);
+    for (size_t& end : datum_ends_) {
+        end -= consumed_;
+    }
+    consumed_ = 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "datum_scanner.h"
+#include "object.h"
+
+// Push-style reader for input that arrives in arbitrary chunks.
+//
+// Feed() only looks at the bytes it is given: a DatumScanner carries paren
+// depth, a pending quote and a partially received atom across chunks and
+// records where each top-level datum ends. A datum is tokenized and parsed exactly once,
+// when it is taken out, so the work per chunk is bounded by the chunk size.
+class IncrementalReader {
+public:
+    void Feed(std::string_view chunk);
+
+    // No more input will arrive. A trailing atom becomes a complete datum, and
+    // an unfinished one is handed to the parser to report the SyntaxError.
+    void Finish();
+
+    // The next complete datum, or std::nullopt if more input is needed. The
+    // empty list is a valid datum and comes back as a contained nullptr.
+    std::optional<Ref<Object>> TryReadDatum();
+
+    // Same as TryReadDatum(), but returns the datum's source text instead of
+    // parsing it. The view is valid until the next call on the reader.
+    std::optional<std::string_view> TryReadSource();
+
+    // Input received but not yet returned as a datum, in bytes.
+    size_t Buffered() const {
+        return buffer_.size() - consumed_;
+    }
+
+private:
+    void Compact();
+
+    std::string buffer_;
+    size_t consumed_ = 0;
+    std::deque<size_t> datum_ends_;
+
+    DatumScanner scanner_;
+    bool finished_ = false;
+};
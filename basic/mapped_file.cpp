@@ -0,0 +1,65 @@
+#include <mapped_file.h>
+#include "error.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw RuntimeError{"cannot open " + path + ": " + std::strerror(errno)};
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        throw RuntimeError{"cannot stat " + path + ": " + std::strerror(err)};
+    }
+    if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+        ReadAll(fd, path);
+        return;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    close(fd);
+    if (data == MAP_FAILED) {
+        size_ = 0;
+        throw RuntimeError{"cannot map " + path + ": " + std::strerror(err)};
+    }
+    // The tokenizer reads front to back exactly once.
+    madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(data);
+}
+
+void MappedFile::ReadAll(int fd, const std::string& path) {
+    char buffer[1 << 16];
+    while (true) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count == 0) {
+            break;
+        }
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int err = errno;
+            close(fd);
+            throw RuntimeError{"cannot read " + path + ": " + std::strerror(err)};
+        }
+        contents_.append(buffer, static_cast<size_t>(count));
+    }
+    close(fd);
+    data_ = contents_.data();
+    size_ = contents_.size();
+}
+
+MappedFile::~MappedFile() {
+    if (data_ && data_ != contents_.data()) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
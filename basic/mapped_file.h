@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// A read-only memory mapping of a whole file. The pages come straight from the
+// page cache, so a Tokenizer built over View() reads the file without copying it.
+// A pipe, a terminal or /dev/stdin cannot be mapped and is read into memory
+// instead, as is a file that reports no size, such as those under /proc.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    std::string_view View() const {
+        return {data_, size_};
+    }
+
+private:
+    // Reads fd to the end into contents_ and closes it.
+    void ReadAll(int fd, const std::string& path);
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    // What was read when the file could not be mapped.
+    std::string contents_;
+};
@@ -1,36 +1,195 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
+#if __has_include(<sys/single_threaded.h>)
+#include <sys/single_threaded.h>
+#endif
+#include "arena.h"
 #include "error.h"
+#include "ref.h"
+#include "slab.h"
+#include "value.h"
 #include "string"
+#include "string_view"
 #include "cstdint"
 #include "algorithm"
 #include "vector"
 
-class Object : public std::enable_shared_from_this<Object> {
+// True until the process starts a second thread. Until then reference
+// counts skip the atomic instructions, as std::shared_ptr does.
+inline bool IsSingleThreadedProcess() {
+#if __has_include(<sys/single_threaded.h>)
+    return __libc_single_threaded;
+#else
+    return false;
+#endif
+}
+
+// Integers from SCHEME_SMALL_INTEGER_MIN to SCHEME_SMALL_INTEGER_MAX are
+// preallocated; see Number::Make.
+#ifndef SCHEME_SMALL_INTEGER_MIN
+#define SCHEME_SMALL_INTEGER_MIN -1024
+#endif
+#ifndef SCHEME_SMALL_INTEGER_MAX
+#define SCHEME_SMALL_INTEGER_MAX 65535
+#endif
+
+// What an object is, stored in the object itself so a type check is one byte
+// compare. Every builtin operation is an OPERATION.
+enum class ObjectType : uint8_t { NUMBER, SYMBOL, CELL, OPERATION };
+
+class Object {
 public:
+    explicit Object(ObjectType type = ObjectType::OPERATION) : type_(type){};
+
+    Object(const Object&) = delete;
+    Object& operator=(const Object&) = delete;
+
     virtual ~Object() = default;
-    virtual std::shared_ptr<Object> Execute() {
-        return std::shared_ptr<Object>();
+
+    // The reference count behind Ref. An object starts with none and is
+    // destroyed when the last one is released. Immortal objects are shared
+    // by every thread and not counted at all.
+    void AddRef() const {
+        if (immortal_) {
+            return;
+        }
+#ifdef SCHEME_SINGLE_THREADED
+        ++refs_;
+#else
+        if (IsSingleThreadedProcess()) {
+            refs_.store(refs_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        } else {
+            refs_.fetch_add(1, std::memory_order_relaxed);
+        }
+#endif
+    }
+
+    void Release() const {
+        if (immortal_) {
+            return;
+        }
+#ifdef SCHEME_SINGLE_THREADED
+        uint32_t left = --refs_;
+#else
+        uint32_t left;
+        if (IsSingleThreadedProcess()) {
+            left = refs_.load(std::memory_order_relaxed) - 1;
+            refs_.store(left, std::memory_order_relaxed);
+        } else {
+            left = refs_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        }
+#endif
+        if (left == 0) {
+            Object* self = const_cast<Object*>(this);
+            if (in_arena_) {
+                ParseArena::Delete(self);
+            } else if (in_slab_) {
+                SlabPool::Delete(self);
+            } else {
+                delete self;
+            }
+        }
+    }
+
+    uint32_t RefCount() const {
+#ifdef SCHEME_SINGLE_THREADED
+        return refs_;
+#else
+        return refs_.load(std::memory_order_relaxed);
+#endif
+    }
+
+    ObjectType Type() const {
+        return type_;
+    }
+
+    virtual Ref<Object> Execute() {
+        return Ref<Object>();
     };
     virtual std::string Serialize() {
         return "";
     };
-    virtual std::shared_ptr<Object> Apply(std::shared_ptr<Object>) {
-        return std::shared_ptr<Object>();
+    // Builtin operations take their operands one at a time and return the
+    // result so far.
+    virtual Value Apply(Value) {
+        return Value();
     };
+
+    // Reports every object and Value this one holds to the collector.
+    virtual void Trace(GcMarker&) const {
+    }
+
+protected:
+    // The write barrier: call before a field of this object is pointed at
+    // value.
+    void RecordWrite(const Object* value) {
+        if (gc_old_ && value && value->gc_owned_ && !value->gc_old_) {
+            ValueScope::Current()->Remember(this);
+        }
+    }
+
+private:
+    friend class GcMarker;
+    friend class Number;
+    friend const Ref<Object>& BooleanObject(bool value);
+    friend class ParseArena;
+    friend class SlabPool;
+    friend class ValueScope;
+
+#ifdef SCHEME_SINGLE_THREADED
+    mutable uint32_t refs_ = 0;
+#else
+    mutable std::atomic<uint32_t> refs_ = 0;
+#endif
+    ObjectType type_;
+    // Made by ParseArena::New or SlabPool::New rather than new.
+    bool in_arena_ : 1 = false;
+    bool in_slab_ : 1 = false;
+    bool immortal_ : 1 = false;
+    // Collector state: owned by the current ValueScope, reached by the mark
+    // phase, promoted out of the nursery, in the remembered set.
+    bool gc_owned_ : 1 = false;
+    bool gc_marked_ : 1 = false;
+    bool gc_old_ : 1 = false;
+    bool gc_remembered_ : 1 = false;
 };
 
 class Number : public Object {
 public:
-    Number(int64_t val) : val_(val){};
+    static constexpr ObjectType kType = ObjectType::NUMBER;
+
+    Number(int64_t val) : Object(kType), val_(val){};
 
     int64_t GetValue() const {
         return val_;
     }
 
-    std::shared_ptr<Object> Execute() override {
-        return std::shared_ptr<Object>(new Number(val_));
+    // The shared immutable Number for a small integer, or null when value is
+    // out of the range. Its reference count is never touched.
+    static Number* Small(int64_t value) {
+        if (value < kSmallMin || value > kSmallMax) {
+            return nullptr;
+        }
+        uint64_t index = static_cast<uint64_t>(value - kSmallMin);
+        Number* block = small_blocks_[index / kSmallBlockSize].load(std::memory_order_acquire);
+        if (!block) {
+            block = MakeSmallBlock(index / kSmallBlockSize);
+        }
+        return block + index % kSmallBlockSize;
+    }
+
+    // The shared Number for value when it is small, and a new one otherwise.
+    static Ref<Object> Make(int64_t value) {
+        if (Number* small = Small(value)) {
+            return Ref<Object>(small);
+        }
+        return Ref<Object>(SlabPool::New<Number>(value));
+    }
+
+    Ref<Object> Execute() override {
+        return Make(val_);
     }
 
     std::string Serialize() override {
@@ -38,21 +197,38 @@ public:
     }
 
 private:
+    // The range Small covers, set at build time; an empty one turns it off.
+    static constexpr int64_t kSmallMin = SCHEME_SMALL_INTEGER_MIN;
+    static constexpr int64_t kSmallMax = SCHEME_SMALL_INTEGER_MAX;
+
+    // The small integers are made a block at a time, when one of them is
+    // first asked for, so a process pays only for the part of the range it
+    // uses. Blocks are never freed.
+    static constexpr size_t kSmallBlockSize = 256;
+    static constexpr size_t kSmallBlocks =
+        kSmallMax < kSmallMin ? 1 : (kSmallMax - kSmallMin) / kSmallBlockSize + 1;
+    static Number* MakeSmallBlock(size_t block);
+    inline static constinit std::atomic<Number*> small_blocks_[kSmallBlocks] = {};
+
     int64_t val_;
 };
 
 class Symbol : public Object {
 public:
-    Symbol(std::string& name) : name_(name){};
+    static constexpr ObjectType kType = ObjectType::SYMBOL;
+
+    Symbol(std::string& name) : Object(kType), name_(name){};
+
+    Symbol(const char* name) : Object(kType), name_(name){};
 
-    Symbol(const char* name) : name_(name){};
+    Symbol(std::string_view name) : Object(kType), name_(name){};
 
     const std::string& GetName() const {
         return name_;
     }
 
-    std::shared_ptr<Object> Execute() override {
-        return std::shared_ptr<Object>(new Symbol(name_));
+    Ref<Object> Execute() override {
+        return Ref<Object>(SlabPool::New<Symbol>(name_));
     }
 
     std::string Serialize() override {
@@ -63,36 +239,85 @@ private:
     std::string name_;
 };
 
+// #t and #f are read and printed as symbols. They never change, so the
+// reader, the evaluator and the builtins all share one instance of each and
+// a truth test is a pointer compare. Like the small integers they are
+// immortal, so copying a handle to one costs no reference count.
+inline const Ref<Object>& BooleanObject(bool value) {
+    auto make = [](const char* name) {
+        Symbol* symbol = new Symbol(name);
+        symbol->immortal_ = true;
+        return Ref<Object>(symbol);
+    };
+    static const Ref<Object> kTrue = make("#t");
+    static const Ref<Object> kFalse = make("#f");
+    return value ? kTrue : kFalse;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 // Runtime type checking and convertion.
-// This can be helpful: https://en.cppreference.com/w/cpp/memory/shared_ptr/pointer_cast
+// Numbers, symbols and cells carry their type in the object, so checking for
+// them is a tag compare; any other T falls back to dynamic_cast. As
+// returns nullptr when obj is not a T.
 
 template <class T>
-std::shared_ptr<T> As(const std::shared_ptr<Object>& obj) {
-    return std::dynamic_pointer_cast<T, Object>(obj);
+bool Is(const Ref<Object>& obj) {
+    if constexpr (requires { T::kType; }) {
+        return obj && obj->Type() == T::kType;
+    } else {
+        return dynamic_cast<T*>(obj.get()) != nullptr;
+    }
 }
 
 template <class T>
-bool Is(const std::shared_ptr<Object>& obj) {
-    if (std::dynamic_pointer_cast<T, Object>(obj) == nullptr) {
-        return false;
+Ref<T> As(const Ref<Object>& obj) {
+    if constexpr (requires { T::kType; }) {
+        return Is<T>(obj) ? Ref<T>(static_cast<T*>(obj.get())) : nullptr;
+    } else {
+        return Ref<T>(dynamic_cast<T*>(obj.get()));
     }
-    return true;
 }
 
 class Cell : public Object {
 public:
-    Cell(std::shared_ptr<Object> first, std::shared_ptr<Object> second)
-        : first_(first), second_(second){};
+    static constexpr ObjectType kType = ObjectType::CELL;
 
-    std::shared_ptr<Object> GetFirst() {
+    Cell(Ref<Object> first, Ref<Object> second)
+        : Object(kType), first_(std::move(first)), second_(std::move(second)){};
+
+    const Ref<Object>& GetFirst() const {
         return first_;
     }
-    std::shared_ptr<Object> GetSecond() {
+    const Ref<Object>& GetSecond() const {
         return second_;
     }
 
+    void SetSecond(Ref<Object> second) {
+        RecordWrite(second.get());
+        second_ = std::move(second);
+    }
+
+    void Trace(GcMarker& marker) const override {
+        marker.Mark(first_);
+        marker.Mark(second_);
+    }
+
+    // Releases nested cells from an explicit worklist: letting each Cell
+    // destroy its children would recurse once per element and per level.
+    ~Cell() override {
+        if (!IsUniqueCell(first_) && !IsUniqueCell(second_)) {
+            return;
+        }
+        std::vector<Ref<Object>> pending;
+        DetachChildren(pending);
+        while (!pending.empty()) {
+            Ref<Object> cell = std::move(pending.back());
+            pending.pop_back();
+            static_cast<Cell*>(cell.get())->DetachChildren(pending);
+        }
+    }
+
     std::string Serialize() override {
         if (first_ != nullptr && second_ != nullptr) {
             return '(' + first_->Serialize() + ' ' + second_->Serialize() + ')';
@@ -106,15 +331,29 @@ public:
     }
 
 private:
-    std::shared_ptr<Object> first_ = nullptr;
-    std::shared_ptr<Object> second_ = nullptr;
+    // Only the last owner of a cell destroys it.
+    static bool IsUniqueCell(const Ref<Object>& object) {
+        return object.use_count() == 1 && object->Type() == kType;
+    }
+
+    void DetachChildren(std::vector<Ref<Object>>& pending) {
+        if (IsUniqueCell(first_)) {
+            pending.push_back(std::move(first_));
+        }
+        if (IsUniqueCell(second_)) {
+            pending.push_back(std::move(second_));
+        }
+    }
+
+    Ref<Object> first_ = nullptr;
+    Ref<Object> second_ = nullptr;
 };
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 class QuoteOperation : public Object {
 public:
     QuoteOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) {
+    Value Apply(Value operand) override {
         return operand;
     }
 };
@@ -123,14 +362,16 @@ class AddOperation : public Object {
 public:
     AddOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) {
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Number(0));
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
+            return Value::Integer(0);
         }
-        if (Is<Number>(operand)) {
-            total_sum_ += As<Number>(operand)->GetValue();
+        if (operand.IsInteger()) {
+            if (__builtin_add_overflow(total_sum_, operand.GetInteger(), &total_sum_)) {
+                throw RuntimeError{"integer overflow in +"};
+            }
         }
-        return std::shared_ptr<Object>(new Number(total_sum_));
+        return Value::Integer(total_sum_);
     }
 
 private:
@@ -141,18 +382,15 @@ class CheckIfNumber : public Object {
 public:
     CheckIfNumber() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
+    Value Apply(Value operand) override {
         if (is_first_) {
             is_first_ = false;
-            return std::shared_ptr<Object>(new Symbol("#t"));
+            return Value::True();
         }
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
+        if (operand.IsNil()) {
+            return Value::True();
         }
-        if (Is<Number>(operand)) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
-        }
-        return std::shared_ptr<Object>(new Symbol("#f"));
+        return Value::Boolean(operand.IsInteger());
     }
 
 private:
@@ -163,28 +401,26 @@ class CheckIfEqual : public Object {
 public:
     CheckIfEqual() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
+    Value Apply(Value operand) override {
         if (ne_) {
-            return std::shared_ptr<Object>(new Symbol("#f"));
+            return Value::False();
         }
-        if (is_first_ && operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
+        if (is_first_ && operand.IsNil()) {
+            return Value::True();
         } else if (is_first_) {
             is_first_ = false;
-            if (operand != nullptr) {
-                prev_number_ = As<Number>(operand)->GetValue();
-            }
-            return std::shared_ptr<Object>(new Symbol("#t"));
+            prev_number_ = operand.GetInteger();
+            return Value::True();
         }
-        if (Is<Number>(operand)) {
-            if (prev_number_ == As<Number>(operand)->GetValue()) {
-                prev_number_ = As<Number>(operand)->GetValue();
-                return std::shared_ptr<Object>(new Symbol("#t"));
+        if (operand.IsInteger()) {
+            if (prev_number_ == operand.GetInteger()) {
+                prev_number_ = operand.GetInteger();
+                return Value::True();
             }
             ne_ = true;
-            return std::shared_ptr<Object>(new Symbol("#f"));
+            return Value::False();
         }
-        return std::shared_ptr<Object>();
+        return Value::Nil();
     }
 
 private:
@@ -197,28 +433,26 @@ class CheckIfLess : public Object {
 public:
     CheckIfLess() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
+    Value Apply(Value operand) override {
         if (nge_) {
-            return std::shared_ptr<Object>(new Symbol("#f"));
+            return Value::False();
         }
-        if (is_first_ && operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
+        if (is_first_ && operand.IsNil()) {
+            return Value::True();
         } else if (is_first_) {
             is_first_ = false;
-            if (operand != nullptr) {
-                prev_number_ = As<Number>(operand)->GetValue();
-            }
-            return std::shared_ptr<Object>(new Symbol("#t"));
+            prev_number_ = operand.GetInteger();
+            return Value::True();
         }
-        if (Is<Number>(operand)) {
-            if (prev_number_ < As<Number>(operand)->GetValue()) {
-                prev_number_ = As<Number>(operand)->GetValue();
-                return std::shared_ptr<Object>(new Symbol("#t"));
+        if (operand.IsInteger()) {
+            if (prev_number_ < operand.GetInteger()) {
+                prev_number_ = operand.GetInteger();
+                return Value::True();
             }
             nge_ = true;
-            return std::shared_ptr<Object>(new Symbol("#f"));
+            return Value::False();
         }
-        return std::shared_ptr<Object>();
+        return Value::Nil();
     }
 
 private:
@@ -231,28 +465,26 @@ class CheckIfLessOrEqual : public Object {
 public:
     CheckIfLessOrEqual() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
+    Value Apply(Value operand) override {
         if (ng_) {
-            return std::shared_ptr<Object>(new Symbol("#f"));
+            return Value::False();
         }
-        if (is_first_ && operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
+        if (is_first_ && operand.IsNil()) {
+            return Value::True();
         } else if (is_first_) {
             is_first_ = false;
-            if (operand != nullptr) {
-                prev_number_ = As<Number>(operand)->GetValue();
-            }
-            return std::shared_ptr<Object>(new Symbol("#t"));
+            prev_number_ = operand.GetInteger();
+            return Value::True();
         }
-        if (Is<Number>(operand)) {
-            if (prev_number_ <= As<Number>(operand)->GetValue()) {
-                prev_number_ = As<Number>(operand)->GetValue();
-                return std::shared_ptr<Object>(new Symbol("#t"));
+        if (operand.IsInteger()) {
+            if (prev_number_ <= operand.GetInteger()) {
+                prev_number_ = operand.GetInteger();
+                return Value::True();
             }
             ng_ = true;
-            return std::shared_ptr<Object>(new Symbol("#f"));
+            return Value::False();
         }
-        return std::shared_ptr<Object>();
+        return Value::Nil();
     }
 
 private:
@@ -265,28 +497,26 @@ class CheckIfGreater : public Object {
 public:
     CheckIfGreater() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
+    Value Apply(Value operand) override {
         if (nle_) {
-            return std::shared_ptr<Object>(new Symbol("#f"));
+            return Value::False();
         }
-        if (is_first_ && operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
+        if (is_first_ && operand.IsNil()) {
+            return Value::True();
         } else if (is_first_) {
             is_first_ = false;
-            if (operand != nullptr) {
-                prev_number_ = As<Number>(operand)->GetValue();
-            }
-            return std::shared_ptr<Object>(new Symbol("#t"));
+            prev_number_ = operand.GetInteger();
+            return Value::True();
         }
-        if (Is<Number>(operand)) {
-            if (prev_number_ > As<Number>(operand)->GetValue()) {
-                prev_number_ = As<Number>(operand)->GetValue();
-                return std::shared_ptr<Object>(new Symbol("#t"));
+        if (operand.IsInteger()) {
+            if (prev_number_ > operand.GetInteger()) {
+                prev_number_ = operand.GetInteger();
+                return Value::True();
             }
             nle_ = true;
-            return std::shared_ptr<Object>(new Symbol("#f"));
+            return Value::False();
         }
-        return std::shared_ptr<Object>();
+        return Value::Nil();
     }
 
 private:
@@ -299,28 +529,26 @@ class CheckIfGreaterOrEqual : public Object {
 public:
     CheckIfGreaterOrEqual() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
+    Value Apply(Value operand) override {
         if (nl_) {
-            return std::shared_ptr<Object>(new Symbol("#f"));
+            return Value::False();
         }
-        if (is_first_ && operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
+        if (is_first_ && operand.IsNil()) {
+            return Value::True();
         } else if (is_first_) {
             is_first_ = false;
-            if (operand != nullptr) {
-                prev_number_ = As<Number>(operand)->GetValue();
-            }
-            return std::shared_ptr<Object>(new Symbol("#t"));
+            prev_number_ = operand.GetInteger();
+            return Value::True();
         }
-        if (Is<Number>(operand)) {
-            if (prev_number_ >= As<Number>(operand)->GetValue()) {
-                prev_number_ = As<Number>(operand)->GetValue();
-                return std::shared_ptr<Object>(new Symbol("#t"));
+        if (operand.IsInteger()) {
+            if (prev_number_ >= operand.GetInteger()) {
+                prev_number_ = operand.GetInteger();
+                return Value::True();
             }
             nl_ = true;
-            return std::shared_ptr<Object>(new Symbol("#f"));
+            return Value::False();
         }
-        return std::shared_ptr<Object>();
+        return Value::Nil();
     }
 
 private:
@@ -332,19 +560,21 @@ class MinusOperation : public Object {
 public:
     MinusOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) {
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Number(0));
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
+            return Value::Integer(0);
         }
-        if (Is<Number>(operand)) {
+        if (operand.IsInteger()) {
             if (!is_first) {
-                total_sum_ -= As<Number>(operand)->GetValue();
+                if (__builtin_sub_overflow(total_sum_, operand.GetInteger(), &total_sum_)) {
+                    throw RuntimeError{"integer overflow in -"};
+                }
             } else {
-                total_sum_ += As<Number>(operand)->GetValue();
+                total_sum_ = operand.GetInteger();
                 is_first = false;
             }
         }
-        return std::shared_ptr<Object>(new Number(total_sum_));
+        return Value::Integer(total_sum_);
     }
 
 private:
@@ -356,19 +586,22 @@ class DivisionOperation : public Object {
 public:
     DivisionOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) {
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Number(1));
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
+            return Value::Integer(1);
         }
-        if (Is<Number>(operand)) {
+        if (operand.IsInteger()) {
             if (!is_first) {
-                total_sum_ /= As<Number>(operand)->GetValue();
+                if (total_sum_ == INT64_MIN && operand.GetInteger() == -1) {
+                    throw RuntimeError{"integer overflow in /"};
+                }
+                total_sum_ /= operand.GetInteger();
             } else {
-                total_sum_ = As<Number>(operand)->GetValue();
+                total_sum_ = operand.GetInteger();
                 is_first = false;
             }
         }
-        return std::shared_ptr<Object>(new Number(total_sum_));
+        return Value::Integer(total_sum_);
     }
 
 private:
@@ -380,14 +613,16 @@ class MultiplicationOperation : public Object {
 public:
     MultiplicationOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) {
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Number(1));
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
+            return Value::Integer(1);
         }
-        if (Is<Number>(operand)) {
-            total_sum_ *= As<Number>(operand)->GetValue();
+        if (operand.IsInteger()) {
+            if (__builtin_mul_overflow(total_sum_, operand.GetInteger(), &total_sum_)) {
+                throw RuntimeError{"integer overflow in *"};
+            }
         }
-        return std::shared_ptr<Object>(new Number(total_sum_));
+        return Value::Integer(total_sum_);
     }
 
 private:
@@ -398,14 +633,14 @@ class MaxOperation : public Object {
 public:
     MaxOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) {
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Number(INT64_MIN));
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
+            return Value::Integer(INT64_MIN);
         }
-        if (Is<Number>(operand)) {
-            total_max = std::max(As<Number>(operand)->GetValue(), total_max);
+        if (operand.IsInteger()) {
+            total_max = std::max(operand.GetInteger(), total_max);
         }
-        return std::shared_ptr<Object>(new Number(total_max));
+        return Value::Integer(total_max);
     }
 
 private:
@@ -416,14 +651,14 @@ class MinOperation : public Object {
 public:
     MinOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) {
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Number(INT64_MAX));
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
+            return Value::Integer(INT64_MAX);
         }
-        if (Is<Number>(operand)) {
-            total_min = std::min(As<Number>(operand)->GetValue(), total_min);
+        if (operand.IsInteger()) {
+            total_min = std::min(operand.GetInteger(), total_min);
         }
-        return std::shared_ptr<Object>(new Number(total_min));
+        return Value::Integer(total_min);
     }
 
 private:
@@ -434,14 +669,17 @@ class AbsOperation : public Object {
 public:
     AbsOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) {
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Number(0));
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
+            return Value::Integer(0);
         }
-        if (Is<Number>(operand)) {
-            total_abs = std::abs(As<Number>(operand)->GetValue());
+        if (operand.IsInteger()) {
+            if (operand.GetInteger() == INT64_MIN) {
+                throw RuntimeError{"integer overflow in abs"};
+            }
+            total_abs = std::abs(operand.GetInteger());
         }
-        return std::shared_ptr<Object>(new Number(total_abs));
+        return Value::Integer(total_abs);
     }
 
 private:
@@ -452,19 +690,15 @@ class CheckIfBoolean : public Object {
 public:
     CheckIfBoolean() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
+    Value Apply(Value operand) override {
         if (is_first_) {
             is_first_ = false;
-            return std::shared_ptr<Object>(new Symbol("#t"));
+            return Value::True();
         }
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
+        if (operand.IsNil()) {
+            return Value::True();
         }
-        if (Is<Symbol>(operand) &&
-            (As<Symbol>(operand)->GetName() == "#t" || As<Symbol>(operand)->GetName() == "#f")) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
-        }
-        return std::shared_ptr<Object>(new Symbol("#f"));
+        return Value::Boolean(operand.IsBoolean());
     }
 
 private:
@@ -475,22 +709,8 @@ class NotOperation : public Object {
 public:
     NotOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) {
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
-        }
-        if (Is<Symbol>(operand)) {
-            if (As<Symbol>(operand)->GetName() == "#t") {
-                return std::shared_ptr<Object>(new Symbol("#f"));
-            }
-            if (As<Symbol>(operand)->GetName() == "#f") {
-                return std::shared_ptr<Object>(new Symbol("#t"));
-            } else {
-                return std::shared_ptr<Object>(new Symbol("#f"));
-            }
-        } else {
-            return std::shared_ptr<Object>(new Symbol("#f"));
-        }
+    Value Apply(Value operand) override {
+        return Value::Boolean(operand.IsNil() || operand.IsFalse());
     }
 };
 
@@ -498,11 +718,11 @@ class AndOperation : public Object {
 public:
     AndOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) {
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
+            return Value::True();
         }
-        return std::shared_ptr<Object>();
+        return Value::Nil();
     }
 };
 
@@ -510,11 +730,11 @@ class OrOperation : public Object {
 public:
     OrOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) {
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
+            return Value::True();
         }
-        return std::shared_ptr<Object>();
+        return Value::Nil();
     }
 };
 
@@ -522,17 +742,12 @@ class CheckIfNull : public Object {
 public:
     CheckIfNull() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
+    Value Apply(Value operand) override {
         if (is_first_) {
             is_first_ = false;
-            return std::shared_ptr<Object>(new Symbol("#t"));
-        }
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
-        } else if (Is<Symbol>(operand) && As<Symbol>(operand)->GetName() == "quote") {
-            return std::shared_ptr<Object>(new Symbol("#t"));
+            return Value::True();
         }
-        return std::shared_ptr<Object>(new Symbol("#f"));
+        return Value::Boolean(operand.IsNil() || operand.IsSymbolNamed("quote"));
     }
 
 private:
@@ -543,29 +758,19 @@ class CheckIfList : public Object {
 public:
     CheckIfList() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
-        } else if (Is<Symbol>(operand) && As<Symbol>(operand)->GetName() == "quote") {
-            return std::shared_ptr<Object>(new Symbol("#t"));
+    Value Apply(Value operand) override {
+        if (operand.IsNil() || operand.IsSymbolNamed("quote")) {
+            return Value::True();
         }
-        bool flag = false;
-        Helper(operand, flag);
-        if (flag) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
-        }
-        return std::shared_ptr<Object>(new Symbol("#f"));
-    }
-
-private:
-    void Helper(std::shared_ptr<Object> node, bool& flag) {
-        if (node == nullptr) {
-            flag = true;
-            return;
-        }
-        if (Is<Cell>(node)) {
-            Helper(As<Cell>(node)->GetSecond(), flag);
+        // A proper list is a chain of cells ending in '().
+        const Object* node = operand.AsCell();
+        while (node && node->Type() == ObjectType::CELL) {
+            node = static_cast<const Cell*>(node)->GetSecond().get();
+            if (!node) {
+                return Value::True();
+            }
         }
+        return Value::False();
     }
 };
 
@@ -573,19 +778,8 @@ class CheckIfPair : public Object {
 public:
     CheckIfPair() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
-        if (operand == nullptr) {
-            return std::shared_ptr<Object>(new Symbol("#f"));
-        } else if (Is<Symbol>(operand) && As<Symbol>(operand)->GetName() == "quote") {
-            return std::shared_ptr<Object>(new Symbol("#f"));
-        }
-        if (Is<Cell>(operand) && !Is<Cell>(As<Cell>(operand)->GetFirst()) &&
-            (!Is<Cell>(As<Cell>(operand)->GetSecond()) ||
-             (Is<Cell>(As<Cell>(operand)->GetSecond()) &&
-              As<Cell>(As<Cell>(operand)->GetSecond())->GetSecond() == nullptr))) {
-            return std::shared_ptr<Object>(new Symbol("#t"));
-        }
-        return std::shared_ptr<Object>(new Symbol("#t"));
+    Value Apply(Value operand) override {
+        return Value::Boolean(!operand.IsNil() && !operand.IsSymbolNamed("quote"));
     }
 };
 
@@ -593,34 +787,37 @@ class ConstructOperation : public Object {
 public:
     ConstructOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
-        if (operand == nullptr) {
-            return nullptr;
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
+            return Value::Nil();
         }
         if (is_first_) {
             first_ = operand;
             is_first_ = false;
             return first_;
         }
-        second_ = operand;
-        return std::shared_ptr<Object>(new Cell(first_, second_));
+        return Value::Own(ValueScope::Allocate<Cell>(first_.ToObject(), operand.ToObject()));
+    }
+
+    void Trace(GcMarker& marker) const override {
+        marker.Mark(first_);
     }
 
 private:
     bool is_first_ = true;
-    std::shared_ptr<Object> first_, second_;
+    Value first_;
 };
 
 class CarOperation : public Object {
 public:
     CarOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
-        if (operand == nullptr) {
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
             throw RuntimeError{"WTF after car"};
         }
-        if (Is<Cell>(operand)) {
-            return As<Cell>(operand)->GetFirst();
+        if (Cell* cell = operand.AsCell()) {
+            return Value::FromObject(cell->GetFirst());
         }
         return operand;
     }
@@ -630,14 +827,14 @@ class CdrOperation : public Object {
 public:
     CdrOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
-        if (operand == nullptr) {
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
             throw RuntimeError{"WTF after cdr"};
         }
-        if (Is<Cell>(operand)) {
-            return As<Cell>(operand)->GetSecond();
+        if (Cell* cell = operand.AsCell()) {
+            return Value::FromObject(cell->GetSecond());
         }
-        return nullptr;
+        return Value::Nil();
     }
 };
 
@@ -645,48 +842,57 @@ class ListOperation : public Object {
 public:
     ListOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
-        if (operand == nullptr) {
-            return nullptr;
+    // Appends each operand to the list so far, so the list takes linear
+    // time and no stack to build however long it gets.
+    Value Apply(Value operand) override {
+        if (operand.IsNil()) {
+            return Value::Nil();
+        }
+        Ref<Object> cell = ValueScope::Allocate<Cell>(operand.ToObject(), nullptr);
+        Cell* last = static_cast<Cell*>(cell.get());
+        if (last_) {
+            last_->SetSecond(std::move(cell));
+        } else {
+            list_ = std::move(cell);
         }
-        list_.push_back(operand);
-        return MakeList(list_, 0);
+        last_ = last;
+        return Value::Own(list_);
     }
 
-private:
-    std::shared_ptr<Object> MakeList(std::vector<std::shared_ptr<Object>>& nodes, size_t i) {
-        if (i == nodes.size()) {
-            return nullptr;
-        }
-        ++i;
-        return std::shared_ptr<Object>(new Cell(list_[i - 1], MakeList(nodes, i)));
+    void Trace(GcMarker& marker) const override {
+        marker.Mark(list_);
     }
-    std::vector<std::shared_ptr<Object>> list_;
+
+private:
+    Ref<Object> list_;
+    Cell* last_ = nullptr;
 };
 class ListRefOperation : public Object {
 public:
     ListRefOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
-        if (operand == nullptr) {
-            return nullptr;
+    Value Apply(Value operand) override {
+        if (!operand.AsCell()) {
+            return Value::Nil();
         }
-        if (Is<Cell>(operand)) {
-            MakeList(operand, list_);
-            if (list_.empty()) {
-                return nullptr;
-            }
-            if (As<Number>(list_.back())->GetValue() >= static_cast<int64_t>(list_.size()) - 1) {
-                throw RuntimeError{"index-error in list"};
-            }
-            return list_[As<Number>(list_.back())->GetValue()];
-        } else {
-            return nullptr;
+        MakeList(operand.ToObject(), list_);
+        if (list_.empty()) {
+            return Value::Nil();
+        }
+        if (As<Number>(list_.back())->GetValue() >= static_cast<int64_t>(list_.size()) - 1) {
+            throw RuntimeError{"index-error in list"};
+        }
+        return Value::Own(list_[As<Number>(list_.back())->GetValue()]);
+    }
+
+    void Trace(GcMarker& marker) const override {
+        for (const auto& element : list_) {
+            marker.Mark(element);
         }
     }
 
 private:
-    void MakeList(std::shared_ptr<Object> node, std::vector<std::shared_ptr<Object>>& result) {
+    void MakeList(Ref<Object> node, std::vector<Ref<Object>>& result) {
         if (Is<Cell>(node)) {
             if (As<Cell>(node)->GetFirst() == nullptr && As<Cell>(node)->GetSecond() == nullptr) {
                 result.push_back(node);
@@ -713,54 +919,61 @@ private:
             return;
         }
     }
-    std::vector<std::shared_ptr<Object>> list_;
+    std::vector<Ref<Object>> list_;
 };
 
 class ListTailOperation : public Object {
 public:
     ListTailOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand) override {
-        if (operand == nullptr) {
-            return nullptr;
+    Value Apply(Value operand) override {
+        if (!operand.AsCell()) {
+            return Value::Nil();
         }
-        if (Is<Cell>(operand)) {
-            std::shared_ptr<Object> normal = Normilize(operand);
-            MakeList(normal, list_);
-            ToVector(operand, v_);
-            if (list_.empty()) {
-                return nullptr;
-            }
-            if (As<Number>(v_.back())->GetValue() >= static_cast<int64_t>(v_.size())) {
-                throw RuntimeError{"index-error in list"};
-            }
-            return list_[As<Number>(v_.back())->GetValue()];
-        } else {
-            return nullptr;
+        Ref<Object> object = operand.ToObject();
+        Ref<Object> normal = Normilize(object);
+        MakeList(normal, list_);
+        ToVector(object, v_);
+        if (list_.empty()) {
+            return Value::Nil();
+        }
+        if (As<Number>(v_.back())->GetValue() >= static_cast<int64_t>(v_.size())) {
+            throw RuntimeError{"index-error in list"};
+        }
+        // The normalized cells belong to this operation, which dies first.
+        return Value::Own(list_[As<Number>(v_.back())->GetValue()]);
+    }
+
+    void Trace(GcMarker& marker) const override {
+        for (const auto& element : list_) {
+            marker.Mark(element);
+        }
+        for (const auto& element : v_) {
+            marker.Mark(element);
         }
     }
 
 private:
-    std::shared_ptr<Object> Normilize(std::shared_ptr<Object> node) {
+    Ref<Object> Normilize(Ref<Object> node) {
         if (Is<Cell>(node)) {
-            std::shared_ptr<Object> right = As<Cell>(node)->GetSecond();
+            Ref<Object> right = As<Cell>(node)->GetSecond();
             if (Is<Cell>(right) || right == nullptr) {
-                return std::shared_ptr<Object>(
-                    new Cell(As<Cell>(node)->GetFirst(), Normilize(As<Cell>(node)->GetSecond())));
+                return ValueScope::Allocate<Cell>(As<Cell>(node)->GetFirst(),
+                                                  Normilize(As<Cell>(node)->GetSecond()));
             } else if (Is<Number>(right)) {
-                return std::shared_ptr<Object>(new Cell(As<Cell>(node)->GetFirst(), nullptr));
+                return ValueScope::Allocate<Cell>(As<Cell>(node)->GetFirst(), nullptr);
             }
         }
         return nullptr;
     }
-    void MakeList(std::shared_ptr<Object> node, std::vector<std::shared_ptr<Object>>& result) {
+    void MakeList(Ref<Object> node, std::vector<Ref<Object>>& result) {
         if (node == nullptr) {
             result.push_back(nullptr);
             return;
         }
         if (Is<Cell>(node)) {
             result.push_back(node);
-            std::shared_ptr<Object> right = As<Cell>(node)->GetSecond();
+            Ref<Object> right = As<Cell>(node)->GetSecond();
             if (Is<Cell>(right) || right == nullptr) {
                 MakeList(As<Cell>(node)->GetSecond(), result);
                 return;
@@ -774,7 +987,7 @@ private:
             return;
         }
     }
-    void ToVector(std::shared_ptr<Object> node, std::vector<std::shared_ptr<Object>>& result) {
+    void ToVector(Ref<Object> node, std::vector<Ref<Object>>& result) {
         if (Is<Cell>(node)) {
             if (As<Cell>(node)->GetFirst() == nullptr && As<Cell>(node)->GetSecond() == nullptr) {
                 result.push_back(node);
@@ -801,15 +1014,15 @@ private:
             return;
         }
     }
-    std::vector<std::shared_ptr<Object>> list_;
-    std::vector<std::shared_ptr<Object>> v_;
+    std::vector<Ref<Object>> list_;
+    std::vector<Ref<Object>> v_;
 };
 
 class DefineOperation{
 public:
     DefineOperation() = default;
 
-    std::shared_ptr<Object> Apply(std::shared_ptr<Object> operand){
+    Ref<Object> Apply(Ref<Object> operand){
         if (is_first){
 
             is_first = false;
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+
+#include "arena.h"
+#include "object.h"
+
+// The one place the reader creates nodes. Inside a ParseArena::Scope nodes
+// come from that arena; otherwise from this thread's SlabPool. Booleans and
+// small integers are the shared instances.
+
+template <class T, class... Args>
+Ref<Object> MakeNode(Args&&... args) {
+    if (ParseArena* arena = ParseArena::Current()) {
+        return Ref<Object>(arena->New<T>(std::forward<Args>(args)...));
+    }
+    return Ref<Object>(SlabPool::New<T>(std::forward<Args>(args)...));
+}
+
+inline Ref<Object> MakeNumber(int64_t value) {
+    if (Number* small = Number::Small(value)) {
+        return Ref<Object>(small);
+    }
+    return MakeNode<Number>(value);
+}
+
+inline Ref<Object> MakeSymbol(std::string_view name) {
+    if (name == "#t" || name == "#f") {
+        return BooleanObject(name == "#t");
+    }
+    return MakeNode<Symbol>(name);
+}
+
+inline Ref<Object> MakeCell(Ref<Object> first, Ref<Object> second) {
+    return MakeNode<Cell>(std::move(first), std::move(second));
+}
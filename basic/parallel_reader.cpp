@@ -0,0 +1,94 @@
+#include <parallel_reader.h>
+#include "arena.h"
+#include "datum_scanner.h"
+#include "parser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
+std::vector<std::string_view> SplitTopLevel(std::string_view source) {
+    std::vector<std::string_view> slices;
+    size_t begin = 0;
+    auto on_end = [&](size_t end) {
+        slices.push_back(source.substr(begin, end - begin));
+        begin = end;
+    };
+    DatumScanner scanner;
+    scanner.Scan(source, 0, on_end);
+    if (scanner.Finish()) {
+        on_end(source.size());
+    }
+    return slices;
+}
+
+namespace {
+
+// Slices are handed out in batches of about this many bytes, so workers do
+// not contend on the counter for tiny forms.
+constexpr size_t kBatchBytes = 64 * 1024;
+
+}  // namespace
+
+std::vector<Ref<Object>> ReadAllParallel(std::string_view source, size_t threads) {
+    std::vector<std::string_view> slices = SplitTopLevel(source);
+
+    std::vector<size_t> batches{0};
+    size_t batch_bytes = 0;
+    for (size_t i = 0; i < slices.size(); ++i) {
+        batch_bytes += slices[i].size();
+        if (batch_bytes >= kBatchBytes) {
+            batches.push_back(i + 1);
+            batch_bytes = 0;
+        }
+    }
+    if (batches.back() != slices.size()) {
+        batches.push_back(slices.size());
+    }
+    size_t batch_count = batches.size() - 1;
+
+    std::vector<Ref<Object>> data(slices.size());
+    std::vector<std::exception_ptr> errors(batch_count);
+    std::atomic<size_t> next_batch{0};
+    auto work = [&] {
+        for (size_t batch = next_batch++; batch < batch_count; batch = next_batch++) {
+            try {
+                // Each batch parses into its own arena; the nodes keep it alive.
+                ParseArena arena;
+                ParseArena::Scope scope{arena};
+                for (size_t i = batches[batch]; i < batches[batch + 1]; ++i) {
+                    // Read consumes one datum per tokenizer.
+                    Tokenizer tokenizer{slices[i], false};
+                    data[i] = Read(&tokenizer);
+                }
+            } catch (...) {
+                errors[batch] = std::current_exception();
+            }
+        }
+    };
+
+#ifdef SCHEME_SINGLE_THREADED
+    // Reference counts are not atomic, and every thread would share #t and #f.
+    threads = 1;
+#endif
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, batch_count);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    return data;
+}
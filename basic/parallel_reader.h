@@ -0,0 +1,18 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "object.h"
+
+// Splits source at top-level datum boundaries with a DatumScanner pre-scan.
+// Every slice holds one datum, possibly with leading whitespace.
+std::vector<std::string_view> SplitTopLevel(std::string_view source);
+
+// Reads every top-level datum of source, tokenizing and parsing the slices on
+// up to `threads` worker threads (0 means one per hardware thread). The data
+// come back in source order. If several slices are malformed, the error of the
+// first one is thrown. A SCHEME_SINGLE_THREADED build reads on the calling
+// thread only.
+std::vector<Ref<Object>> ReadAllParallel(std::string_view source, size_t threads = 0);
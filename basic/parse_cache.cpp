@@ -0,0 +1,52 @@
+#include <parse_cache.h>
+#include "hash.h"
+
+void ParseCache::SetCapacity(size_t capacity) {
+    capacity_ = capacity;
+    EvictTo(capacity);
+}
+
+std::shared_ptr<const ParsedForm> ParseCache::Find(std::string_view source) {
+    if (capacity_ == 0) {
+        return nullptr;
+    }
+    auto it = index_.find(HashBytes(source));
+    if (it == index_.end() || it->second->source != source) {
+        ++stats_.misses;
+        return nullptr;
+    }
+    ++stats_.hits;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->form;
+}
+
+void ParseCache::Insert(std::string_view source, std::shared_ptr<const ParsedForm> form) {
+    if (capacity_ == 0) {
+        return;
+    }
+    uint64_t hash = HashBytes(source);
+    auto it = index_.find(hash);
+    if (it != index_.end()) {
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+    entries_.push_front({hash, std::string(source), std::move(form)});
+    index_.emplace(hash, entries_.begin());
+    EvictTo(capacity_);
+}
+
+void ParseCache::Invalidate() {
+    if (!entries_.empty()) {
+        ++stats_.invalidations;
+    }
+    index_.clear();
+    entries_.clear();
+}
+
+void ParseCache::EvictTo(size_t size) {
+    while (entries_.size() > size) {
+        index_.erase(entries_.back().hash);
+        entries_.pop_back();
+        ++stats_.evictions;
+    }
+}
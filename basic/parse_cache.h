@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "object.h"
+
+// A form that has been read and has passed every check: the tree Read built
+// and the node list the interpreter evaluates. Never modified once parsed.
+struct ParsedForm {
+    Ref<Object> ast;
+    std::vector<Ref<Object>> nodes;
+};
+
+struct ParseCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t invalidations = 0;
+};
+
+// The most recently used ParsedForms, keyed by their source text. A lookup
+// hashes the text and compares it only with the entry of the same hash; on a
+// hash collision the newer form replaces the older one.
+//
+// A capacity of zero turns the cache off: nothing is hashed, stored or
+// counted.
+class ParseCache {
+public:
+    void SetCapacity(size_t capacity);
+
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+    size_t Size() const {
+        return entries_.size();
+    }
+
+    std::shared_ptr<const ParsedForm> Find(std::string_view source);
+    void Insert(std::string_view source, std::shared_ptr<const ParsedForm> form);
+
+    // Drops every entry, keeping the capacity and the counters.
+    void Invalidate();
+
+    const ParseCacheStats& Stats() const {
+        return stats_;
+    }
+
+private:
+    struct Entry {
+        uint64_t hash;
+        std::string source;
+        std::shared_ptr<const ParsedForm> form;
+    };
+
+    void EvictTo(size_t size);
+
+    size_t capacity_ = 0;
+    // Most recently used first.
+    std::list<Entry> entries_;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+    ParseCacheStats stats_;
+};
@@ -1,152 +1,179 @@
 #include <parser.h>
 #include "deque"
 #include "scheme.h"
+#include "object_factory.h"
 #include "cstdint"
 
-std::shared_ptr<Object> Read(Tokenizer* tokenizer) {
-    if (std::count(tokenizer->GetAllTokens().begin(), tokenizer->GetAllTokens().end(),
-                   Token{BracketToken::CLOSE}) > std::count(tokenizer->GetAllTokens().begin(),
-                                                            tokenizer->GetAllTokens().end(),
-                                                            Token{BracketToken::OPEN})) {
+namespace {
+
+// What the reader does with a datum once it has been read.
+enum class Continuation { LIST_ELEMENT, LIST_TAIL, DOTTED_TAIL, QUOTED };
+
+// One unfinished list or quote. Lists grow in place through `last`.
+struct Frame {
+    Continuation next;
+    Ref<Object> list = nullptr;
+    Cell* last = nullptr;
+    // The list was opened by a '(' read here, not entered through ReadList.
+    bool opened = false;
+};
+
+void Append(Frame& frame, Ref<Object> element) {
+    Ref<Object> cell = MakeCell(std::move(element), nullptr);
+    Cell* appended = static_cast<Cell*>(cell.get());
+    if (frame.last) {
+        frame.last->SetSecond(std::move(cell));
+    } else {
+        frame.list = std::move(cell);
+    }
+    frame.last = appended;
+}
+
+Ref<Object> FinishList(Frame& frame, Ref<Object> tail) {
+    if (!frame.last) {
+        return tail;
+    }
+    frame.last->SetSecond(std::move(tail));
+    return std::move(frame.list);
+}
+
+// The whole input has been consumed by the datum that just closed.
+void CheckComplete(Tokenizer* tokenizer) {
+    const TokenStats& stats = tokenizer->GetStats();
+    if (stats.close != stats.open) {
         throw SyntaxError{"Brackets, bruuuuh"};
     }
-    Token curr_token = tokenizer->GetToken();
-    tokenizer->Next();
-    if (curr_token == Token{BracketToken::OPEN}) {
-        ++tokenizer->brackets_cnt;
-        std::shared_ptr<Object> node = ReadList(tokenizer);
-        tokenizer->Next();
-        if (tokenizer->IsEnd()) {
-            std::vector<Token> tokens = tokenizer->GetAllTokens();
-            int closed = std::count(tokens.begin(), tokens.end(), Token{BracketToken::CLOSE});
-            if (closed != std::count(tokens.begin(), tokens.end(), Token{BracketToken::OPEN})) {
-                throw SyntaxError{"Brackets, bruuuuh"};
-            }
-            if (std::count(tokens.begin(), tokens.end(), Token{QuoteToken()}) != 0) {
-                int cnt = 0;
-                bool flag = false;
-                int i = 0;
-                int count_of_opened = 0;
-                while (tokens[i] != Token{QuoteToken()}) {
-                    if (tokens[i] == Token{BracketToken::OPEN}) {
-                        ++count_of_opened;
-                    } else if (tokens[i] == Token{BracketToken::CLOSE}) {
-                        --count_of_opened;
-                    }
-                    ++i;
-                }
-                for (size_t j = i; j < tokens.size() - count_of_opened; ++j) {
-                    if (tokens[j] == Token{BracketToken::OPEN}) {
-                        ++cnt;
-                    } else if (tokens[j] == Token{BracketToken::CLOSE}) {
-                        --cnt;
-                        if (cnt == 0) {
-                            flag = true;
-                        }
-                    }
-                    if (cnt != 0 && flag) {
-                        throw RuntimeError{"A shit after quote"};
-                    }
-                }
-            }
-        }
-        return node;
-    } else if (ConstantToken* x = std::get_if<ConstantToken>(&curr_token)) {
-        if (!x->is_init) {
-            throw SyntaxError{"Error"};
-        }
-        return std::shared_ptr<Object>(new Number(x->value));
-    } else if (curr_token == Token{DotToken()}) {
-        Token next = tokenizer->GetToken();
-        if (next == Token{BracketToken::CLOSE}) {
-            throw SyntaxError{".)"};
-        }
-        if (tokenizer->IsEnd() && tokenizer->GetToken() == Token{DotToken()}) {
-            throw SyntaxError{"......."};
-        }
-        if (tokenizer->GetToken() == Token{BracketToken::CLOSE}) {
-            --tokenizer->brackets_cnt;
-        }
-        return Read(tokenizer);
-    } else if (curr_token == Token{QuoteToken()}) {
-        if (tokenizer->IsEnd() && tokenizer->GetToken() == Token{QuoteToken()}) {
-            throw SyntaxError{"Nothing to quote"};
-        }
-        if (tokenizer->IsEnd()) {
-            return nullptr;
-        }
-        return std::shared_ptr<Object>(
-            new Cell(std::shared_ptr<Object>(new Symbol("quote")), Read(tokenizer)));
-    } else if (SymbolToken* x3 = std::get_if<SymbolToken>(&curr_token)) {
-        if (tokenizer->GetToken() == Token{BracketToken::CLOSE}) {
-            --tokenizer->brackets_cnt;
-        }
-        return std::shared_ptr<Object>(new Symbol(x3->name));
-    } else if (curr_token == Token{BracketToken::CLOSE}) {
-        --tokenizer->brackets_cnt;
-        Token next = tokenizer->GetToken();
-        if (ConstantToken* x4 = std::get_if<ConstantToken>(&next)) {
-            return std::shared_ptr<Object>(new Number(x4->value));
-        }
-        return nullptr;
+    if (stats.quotes != 0 && stats.reopened_after_quote != SIZE_MAX &&
+        static_cast<int64_t>(stats.reopened_after_quote) <
+            static_cast<int64_t>(stats.count) - stats.depth_at_first_quote) {
+        throw RuntimeError{"A shit after quote"};
     }
-    return std::shared_ptr<Object>();
 }
 
-std::shared_ptr<Object> ReadList(Tokenizer* tokenizer) {
+// Reads one datum with an explicit stack of frames instead of recursion, so
+// neither long nor deeply nested lists use any C++ stack.
+Ref<Object> ReadDatum(Tokenizer* tokenizer, bool in_list) {
+    enum class Step { READ, LIST, RETURN };
+
+    std::vector<Frame> stack;
+    Ref<Object> value;
+    Step step = Step::READ;
+    if (in_list) {
+        stack.push_back({Continuation::LIST_ELEMENT});
+        step = Step::LIST;
+    }
     while (true) {
-        if (tokenizer->IsEnd() && tokenizer->GetToken() != Token{BracketToken::CLOSE}) {
-            throw SyntaxError{"Error!"};
-        }
-        if (tokenizer->GetToken() == Token{BracketToken::CLOSE}) {
-            std::istream* ss = tokenizer->GetStream();
-            char curr = ss->peek();
-            int i = 0;
-            while (i < 100 && curr != ')') {
-                curr = ss->peek();
-                ++i;
-                if (curr == EOF) {
-                    break;
-                }
+        if (step == Step::READ) {
+            if (tokenizer->GetStats().close > tokenizer->GetStats().open) {
+                throw SyntaxError{"Brackets, bruuuuh"};
             }
-            if (curr == ')') {
+            PackedToken curr_token = tokenizer->GetPackedToken();
+            tokenizer->Next();
+            step = Step::RETURN;
+            if (curr_token.Is(TokenKind::OPEN)) {
+                ++tokenizer->brackets_cnt;
+                stack.push_back({Continuation::LIST_ELEMENT, nullptr, nullptr, true});
+                step = Step::LIST;
+            } else if (curr_token.Is(TokenKind::NONE)) {
+                throw SyntaxError{"Error"};
+            } else if (curr_token.IsInteger()) {
+                value = MakeNumber(tokenizer->GetInteger(curr_token));
+            } else if (curr_token.Is(TokenKind::DOT)) {
+                if (tokenizer->GetKind() == TokenKind::CLOSE) {
+                    throw SyntaxError{".)"};
+                }
+                if (tokenizer->IsEnd() && tokenizer->GetKind() == TokenKind::DOT) {
+                    throw SyntaxError{"......."};
+                }
+                // The datum after the dot is read in its place.
+                step = Step::READ;
+            } else if (curr_token.Is(TokenKind::QUOTE)) {
+                if (tokenizer->IsEnd() && tokenizer->GetKind() == TokenKind::QUOTE) {
+                    throw SyntaxError{"Nothing to quote"};
+                }
+                if (tokenizer->IsEnd()) {
+                    value = nullptr;
+                } else {
+                    stack.push_back({Continuation::QUOTED});
+                    step = Step::READ;
+                }
+            } else if (curr_token.Is(TokenKind::SYMBOL)) {
+                if (tokenizer->GetKind() == TokenKind::CLOSE) {
+                    --tokenizer->brackets_cnt;
+                }
+                value = MakeSymbol(tokenizer->GetName(curr_token));
+            } else {
                 --tokenizer->brackets_cnt;
+                const PackedToken& next = tokenizer->GetPackedToken();
+                value = nullptr;
+                if (next.IsInteger()) {
+                    value = MakeNumber(tokenizer->GetInteger(next));
+                }
             }
-            auto ptr = Read(tokenizer);
-            return ptr;
-        }
-        if (tokenizer->GetToken() == Token{DotToken()}) {
-            int pos = static_cast<int>(tokenizer->GetAllTokens().size()) - 3;
-            if (pos < 0) {
-                throw SyntaxError{".num"};
+        } else if (step == Step::LIST) {
+            Frame& frame = stack.back();
+            if (tokenizer->IsEnd() && tokenizer->GetKind() != TokenKind::CLOSE) {
+                throw SyntaxError{"Error!"};
             }
-            tokenizer->Next();
-            Token next = tokenizer->GetToken();
-            if (std::get_if<ConstantToken>(&next)) {
-                std::istream* ss = tokenizer->GetStream();
-                char curr = ss->peek();
-                int i = 0;
-                while (i < 100 && curr == ' ') {
-                    curr = ss->peek();
-                    ++i;
-                    if (curr == EOF) {
-                        break;
+            frame.next = Continuation::LIST_ELEMENT;
+            if (tokenizer->GetKind() == TokenKind::CLOSE) {
+                if (tokenizer->PeekChar() == ')') {
+                    --tokenizer->brackets_cnt;
+                }
+                frame.next = Continuation::LIST_TAIL;
+            } else if (tokenizer->GetKind() == TokenKind::DOT) {
+                int pos = static_cast<int>(tokenizer->GetStats().count) - 3;
+                if (pos < 0) {
+                    throw SyntaxError{".num"};
+                }
+                tokenizer->Next();
+                if (tokenizer->GetPackedToken().IsInteger()) {
+                    if (tokenizer->PeekChar() != ')') {
+                        throw SyntaxError{".num num"};
                     }
                 }
-                if (curr != ')') {
-                    throw SyntaxError{".num num"};
+                if (tokenizer->GetKind() == TokenKind::CLOSE) {
+                    throw SyntaxError{".)"};
                 }
+                frame.next = Continuation::DOTTED_TAIL;
             }
-            if (tokenizer->GetToken() == Token{BracketToken::CLOSE}) {
-                throw SyntaxError{".)"};
+            step = Step::READ;
+        } else {
+            if (stack.empty()) {
+                return value;
             }
-            auto ptr = Read(tokenizer);
-            if (tokenizer->GetToken() == Token{BracketToken::CLOSE}) {
-                --tokenizer->brackets_cnt;
+            Frame& frame = stack.back();
+            if (frame.next == Continuation::QUOTED) {
+                value = MakeCell(MakeSymbol("quote"), std::move(value));
+                stack.pop_back();
+            } else if (frame.next == Continuation::LIST_ELEMENT) {
+                Append(frame, std::move(value));
+                step = Step::LIST;
+            } else {
+                if (frame.next == Continuation::DOTTED_TAIL &&
+                    tokenizer->GetKind() == TokenKind::CLOSE) {
+                    --tokenizer->brackets_cnt;
+                }
+                value = FinishList(frame, std::move(value));
+                bool opened = frame.opened;
+                stack.pop_back();
+                if (opened) {
+                    tokenizer->Next();
+                    if (tokenizer->IsEnd()) {
+                        CheckComplete(tokenizer);
+                    }
+                }
             }
-            return ptr;
-        } else {
-            return std::shared_ptr<Object>(new Cell(Read(tokenizer), ReadList(tokenizer)));
         }
     }
-}
\ No newline at end of file
+}
+
+}  // namespace
+
+Ref<Object> Read(Tokenizer* tokenizer) {
+    return ReadDatum(tokenizer, false);
+}
+
+Ref<Object> ReadList(Tokenizer* tokenizer) {
+    return ReadDatum(tokenizer, true);
+}
@@ -0,0 +1,39 @@
+// Precompiles Scheme source into the .scmb format.
+//
+//   scheme_basic_precompile input.scm [output.scmb]
+//
+// Every top-level datum is read with Read, exactly as the interpreter would
+// read it, and the whole file is written as one flat tree. Without an output
+// path the input's extension is replaced with .scmb.
+
+#include <flat_ast.h>
+#include <mapped_file.h>
+#include <parallel_reader.h>
+#include <scmb.h>
+
+#include <exception>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    if (argc != 2 && argc != 3) {
+        std::cerr << "usage: " << argv[0] << " input.scm [output.scmb]" << std::endl;
+        return 2;
+    }
+    std::string input = argv[1];
+    std::string output = argc == 3 ? argv[2] : input.substr(0, input.rfind(".scm")) + ".scmb";
+    try {
+        MappedFile source{input};
+        FlatAst ast;
+        for (const Ref<Object>& datum : ReadAllParallel(source.View())) {
+            ast.Append(datum);
+        }
+        WriteScmb(ast.View(), output);
+        std::cout << output << ": " << ast.Roots().size() << " data, " << ast.Size() << " nodes"
+                  << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
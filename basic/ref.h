@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// An owning handle to an Object whose reference count lives in the object
+// itself (see Object::AddRef), so there is no separate control block and a
+// copy is one increment. The interface follows std::shared_ptr.
+//
+// With SCHEME_SINGLE_THREADED the count is a plain integer. Otherwise it is
+// atomic once the process has started a thread, because ReadAllParallel
+// builds data on worker threads and they all share the boolean objects.
+template <class T>
+class Ref {
+public:
+    Ref() = default;
+
+    Ref(std::nullptr_t) {
+    }
+
+    // Takes a reference to object, which may be new or already referenced.
+    explicit Ref(T* object) : object_(object) {
+        if (object_) {
+            object_->AddRef();
+        }
+    }
+
+    Ref(const Ref& other) : Ref(other.object_) {
+    }
+
+    Ref(Ref&& other) noexcept : object_(std::exchange(other.object_, nullptr)) {
+    }
+
+    template <class U>
+        requires std::is_convertible_v<U*, T*>
+    Ref(const Ref<U>& other) : Ref(other.get()) {
+    }
+
+    template <class U>
+        requires std::is_convertible_v<U*, T*>
+    Ref(Ref<U>&& other) noexcept : object_(other.release()) {
+    }
+
+    ~Ref() {
+        if (object_) {
+            object_->Release();
+        }
+    }
+
+    Ref& operator=(Ref other) noexcept {
+        std::swap(object_, other.object_);
+        return *this;
+    }
+
+    T* get() const {
+        return object_;
+    }
+
+    T& operator*() const {
+        return *object_;
+    }
+
+    T* operator->() const {
+        return object_;
+    }
+
+    explicit operator bool() const {
+        return object_ != nullptr;
+    }
+
+    void reset() {
+        Ref().swap(*this);
+    }
+
+    void swap(Ref& other) noexcept {
+        std::swap(object_, other.object_);
+    }
+
+    size_t use_count() const {
+        return object_ ? object_->RefCount() : 0;
+    }
+
+    // Gives up the reference without dropping it.
+    T* release() {
+        return std::exchange(object_, nullptr);
+    }
+
+private:
+    T* object_ = nullptr;
+};
+
+template <class T, class U>
+bool operator==(const Ref<T>& lhs, const Ref<U>& rhs) {
+    return lhs.get() == rhs.get();
+}
+
+template <class T>
+bool operator==(const Ref<T>& lhs, std::nullptr_t) {
+    return lhs.get() == nullptr;
+}
+
+template <class T, class... Args>
+Ref<T> MakeRef(Args&&... args) {
+    return Ref<T>(new T(std::forward<Args>(args)...));
+}
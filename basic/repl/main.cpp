@@ -1,5 +1,30 @@
 #include <iostream>
+#include <string>
+
+#include <incremental_reader.h>
+#include <scheme.h>
 
 int main() {
+    Interpreter interpreter;
+    IncrementalReader reader;
+    auto run_ready = [&] {
+        while (auto source = reader.TryReadSource()) {
+            try {
+                std::cout << interpreter.Run(*source) << std::endl;
+            } catch (const std::exception& e) {
+                std::cout << e.what() << std::endl;
+            }
+        }
+    };
+
+    // Lines are fed as they arrive, so a form may span several of them.
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        line.push_back('\n');
+        reader.Feed(line);
+        run_ready();
+    }
+    reader.Finish();
+    run_ready();
     return 0;
 }
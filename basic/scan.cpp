@@ -0,0 +1,253 @@
+#include <scan.h>
+#include "char_class.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define SCHEME_SCAN_X86 1
+#endif
+
+namespace {
+
+template <uint8_t Class>
+const char* SkipScalar(const char* begin, const char* end) {
+    while (begin != end && (kCharClass[static_cast<unsigned char>(*begin)] & Class)) {
+        ++begin;
+    }
+    return begin;
+}
+
+BlockMasks ClassifyScalar(const char* begin, const char* end) {
+    BlockMasks masks;
+    for (int i = 0; begin + i != end; ++i) {
+        uint64_t bit = uint64_t{1} << i;
+        char c = begin[i];
+        if (kCharClass[static_cast<unsigned char>(c)] & kSpace) {
+            masks.space |= bit;
+        } else if (c == '(') {
+            masks.open |= bit;
+        } else if (c == ')') {
+            masks.close |= bit;
+        } else if (c == '\'') {
+            masks.quote |= bit;
+        }
+    }
+    return masks;
+}
+
+#ifdef SCHEME_SCAN_X86
+
+// Every class is a union of byte ranges, so the vector code needs only
+// compares. All ranges are below 0x80, where signed and unsigned order agree.
+
+inline __m128i InRange(__m128i v, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                         _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+inline __m128i Equal(__m128i v, char c) {
+    return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+inline __m128i SpaceMask(__m128i v) {
+    return _mm_or_si128(Equal(v, ' '), InRange(v, '\t', '\r'));
+}
+
+inline __m128i DigitMask(__m128i v) {
+    return InRange(v, '0', '9');
+}
+
+// '/' and the digits are adjacent, and so are '<', '=', '>' and '?'.
+inline __m128i SymbolMask(__m128i v) {
+    __m128i ranges = _mm_or_si128(_mm_or_si128(InRange(v, '/', '9'), InRange(v, '<', '?')),
+                                  _mm_or_si128(InRange(v, 'A', 'Z'), InRange(v, 'a', 'z')));
+    __m128i singles = _mm_or_si128(_mm_or_si128(Equal(v, '!'), Equal(v, '#')),
+                                   _mm_or_si128(Equal(v, '*'), Equal(v, '-')));
+    return _mm_or_si128(ranges, singles);
+}
+
+template <__m128i (*Mask)(__m128i), uint8_t Class>
+const char* SkipSse2(const char* begin, const char* end) {
+    while (end - begin >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        unsigned outside = ~static_cast<unsigned>(_mm_movemask_epi8(Mask(v))) & 0xFFFF;
+        if (outside) {
+            return begin + __builtin_ctz(outside);
+        }
+        begin += 16;
+    }
+    return SkipScalar<Class>(begin, end);
+}
+
+BlockMasks ClassifySse2(const char* begin, const char* end) {
+    if (end - begin < 64) {
+        return ClassifyScalar(begin, end);
+    }
+    BlockMasks masks;
+    for (int i = 0; i < 64; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin + i));
+        auto bits = [i](__m128i mask) {
+            return static_cast<uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(mask))) << i;
+        };
+        masks.space |= bits(SpaceMask(v));
+        masks.open |= bits(Equal(v, '('));
+        masks.close |= bits(Equal(v, ')'));
+        masks.quote |= bits(Equal(v, '\''));
+    }
+    return masks;
+}
+
+#define SCHEME_AVX2 __attribute__((target("avx2")))
+
+SCHEME_AVX2 inline __m256i InRange(__m256i v, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+SCHEME_AVX2 inline __m256i Equal(__m256i v, char c) {
+    return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+
+SCHEME_AVX2 inline __m256i SpaceMask(__m256i v) {
+    return _mm256_or_si256(Equal(v, ' '), InRange(v, '\t', '\r'));
+}
+
+SCHEME_AVX2 inline __m256i DigitMask(__m256i v) {
+    return InRange(v, '0', '9');
+}
+
+SCHEME_AVX2 inline __m256i SymbolMask(__m256i v) {
+    __m256i ranges =
+        _mm256_or_si256(_mm256_or_si256(InRange(v, '/', '9'), InRange(v, '<', '?')),
+                        _mm256_or_si256(InRange(v, 'A', 'Z'), InRange(v, 'a', 'z')));
+    __m256i singles = _mm256_or_si256(_mm256_or_si256(Equal(v, '!'), Equal(v, '#')),
+                                      _mm256_or_si256(Equal(v, '*'), Equal(v, '-')));
+    return _mm256_or_si256(ranges, singles);
+}
+
+template <__m256i (*Mask)(__m256i), __m128i (*Tail)(__m128i), uint8_t Class>
+SCHEME_AVX2 const char* SkipAvx2(const char* begin, const char* end) {
+    while (end - begin >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        unsigned outside = ~static_cast<unsigned>(_mm256_movemask_epi8(Mask(v)));
+        if (outside) {
+            return begin + __builtin_ctz(outside);
+        }
+        begin += 32;
+    }
+    return SkipSse2<Tail, Class>(begin, end);
+}
+
+SCHEME_AVX2 BlockMasks ClassifyAvx2(const char* begin, const char* end) {
+    if (end - begin < 64) {
+        return ClassifyScalar(begin, end);
+    }
+    BlockMasks masks;
+    for (int i = 0; i < 64; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin + i));
+        auto bits = [i](__m256i mask) SCHEME_AVX2 {
+            return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(mask))) << i;
+        };
+        masks.space |= bits(SpaceMask(v));
+        masks.open |= bits(Equal(v, '('));
+        masks.close |= bits(Equal(v, ')'));
+        masks.quote |= bits(Equal(v, '\''));
+    }
+    return masks;
+}
+
+#endif
+
+using SkipFn = const char* (*)(const char*, const char*);
+
+using ClassifyFn = BlockMasks (*)(const char*, const char*);
+
+struct ScanTable {
+    SkipFn spaces;
+    SkipFn symbol_chars;
+    SkipFn digits;
+    ClassifyFn classify;
+};
+
+constexpr ScanTable kScalarTable{SkipScalar<kSpace>, SkipScalar<kSymbolChar>,
+                                 SkipScalar<kDigit>, ClassifyScalar};
+
+#ifdef SCHEME_SCAN_X86
+constexpr ScanTable kSse2Table{SkipSse2<SpaceMask, kSpace>, SkipSse2<SymbolMask, kSymbolChar>,
+                               SkipSse2<DigitMask, kDigit>, ClassifySse2};
+
+constexpr ScanTable kAvx2Table{SkipAvx2<SpaceMask, SpaceMask, kSpace>,
+                               SkipAvx2<SymbolMask, SymbolMask, kSymbolChar>,
+                               SkipAvx2<DigitMask, DigitMask, kDigit>, ClassifyAvx2};
+#endif
+
+bool Supports(ScanImpl impl) {
+    switch (impl) {
+        case ScanImpl::kScalar:
+            return true;
+#ifdef SCHEME_SCAN_X86
+        case ScanImpl::kSse2:
+            return true;
+        case ScanImpl::kAvx2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+ScanImpl BestImpl() {
+    for (ScanImpl impl : {ScanImpl::kAvx2, ScanImpl::kSse2}) {
+        if (Supports(impl)) {
+            return impl;
+        }
+    }
+    return ScanImpl::kScalar;
+}
+
+const ScanTable& TableFor(ScanImpl impl) {
+    switch (impl) {
+#ifdef SCHEME_SCAN_X86
+        case ScanImpl::kSse2:
+            return kSse2Table;
+        case ScanImpl::kAvx2:
+            return kAvx2Table;
+#endif
+        default:
+            return kScalarTable;
+    }
+}
+
+ScanImpl current_impl = BestImpl();
+const ScanTable* current_table = &TableFor(current_impl);
+
+}  // namespace
+
+const char* scan_internal::SkipSpacesWide(const char* begin, const char* end) {
+    return current_table->spaces(begin, end);
+}
+
+const char* scan_internal::SkipSymbolCharsWide(const char* begin, const char* end) {
+    return current_table->symbol_chars(begin, end);
+}
+
+const char* scan_internal::SkipDigitsWide(const char* begin, const char* end) {
+    return current_table->digits(begin, end);
+}
+
+BlockMasks ClassifyBlock(const char* begin, const char* end) {
+    return current_table->classify(begin, end);
+}
+
+ScanImpl GetScanImpl() {
+    return current_impl;
+}
+
+bool SetScanImpl(ScanImpl impl) {
+    if (!Supports(impl)) {
+        return false;
+    }
+    current_impl = impl;
+    current_table = &TableFor(impl);
+    return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "char_class.h"
+
+// Bulk scanners over a contiguous buffer. Each returns the first position in
+// [begin, end) whose character is outside the class, or end.
+//
+// On x86-64 they look at 16 (SSE2) or 32 (AVX2) bytes per step; the widest
+// implementation the CPU supports is picked when the program starts.
+
+namespace scan_internal {
+
+// The implementations picked at startup, for what is left after a short run.
+const char* SkipSpacesWide(const char* begin, const char* end);
+const char* SkipSymbolCharsWide(const char* begin, const char* end);
+const char* SkipDigitsWide(const char* begin, const char* end);
+
+// Most runs are a few bytes long: a single space between tokens, a short
+// name. Those are settled inline with table lookups, before paying for a call
+// into a vector implementation.
+constexpr ptrdiff_t kShortRun = 16;
+
+template <uint8_t Class>
+inline const char* Skip(const char* begin, const char* end,
+                        const char* (*wide)(const char*, const char*)) {
+    const char* short_end = end - begin > kShortRun ? begin + kShortRun : end;
+    for (; begin != short_end; ++begin) {
+        if (!(kCharClass[static_cast<unsigned char>(*begin)] & Class)) {
+            return begin;
+        }
+    }
+    return begin == end ? end : wide(begin, end);
+}
+
+}  // namespace scan_internal
+
+inline const char* SkipSpaces(const char* begin, const char* end) {
+    return scan_internal::Skip<kSpace>(begin, end, scan_internal::SkipSpacesWide);
+}
+
+inline const char* SkipSymbolChars(const char* begin, const char* end) {
+    return scan_internal::Skip<kSymbolChar>(begin, end, scan_internal::SkipSymbolCharsWide);
+}
+
+inline const char* SkipDigits(const char* begin, const char* end) {
+    return scan_internal::Skip<kDigit>(begin, end, scan_internal::SkipDigitsWide);
+}
+
+// Bit i of each mask describes begin[i]. A block is at most 64 bytes; bits
+// past its end are zero.
+struct BlockMasks {
+    uint64_t space = 0;
+    uint64_t open = 0;
+    uint64_t close = 0;
+    uint64_t quote = 0;
+};
+
+BlockMasks ClassifyBlock(const char* begin, const char* end);
+
+enum class ScanImpl { kScalar, kSse2, kAvx2 };
+
+ScanImpl GetScanImpl();
+
+// Returns false if the CPU cannot run impl. Used by tests and benchmarks.
+bool SetScanImpl(ScanImpl impl);
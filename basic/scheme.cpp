@@ -1,39 +1,60 @@
 #include "scheme.h"
+#include "arena.h"
+#include "datum_scanner.h"
+#include "incremental_reader.h"
+#include "mapped_file.h"
 
-std::shared_ptr<Object> Interpreter::Evaluate(std::vector<std::shared_ptr<Object>> nodes) {
-    std::deque<std::shared_ptr<Object>> st_op;
-    std::deque<std::shared_ptr<Object>> st_res;
+namespace {
+
+// What car and cdr are first applied to, in place of '().
+Value NullptrMarker() {
+    static const Ref<Object> kMarker(new Symbol("nullptr"));
+    return Value::FromObject(kMarker);
+}
+
+}  // namespace
+
+Ref<Object> Interpreter::Evaluate(std::vector<Ref<Object>> nodes) {
+    ValueScope scope{gc_options_, &gc_stats_};
+    return EvaluateValue(nodes).ToObject();
+}
+
+Value Interpreter::EvaluateValue(const std::vector<Ref<Object>>& nodes) {
+    ValueScope& heap = *ValueScope::Current();
+    ValueRoots frame;
+    std::vector<Ref<Object>>& st_op = frame.operations;
+    std::vector<Value>& st_res = frame.values;
     if (nodes.size() == 1 &&
         (Is<Number>(nodes[0]) ||
          (Is<Symbol>(nodes[0]) &&
           operations.find(As<Symbol>(nodes[0])->GetName()) == operations.end()))) {
-        return nodes[0];
+        return Value::FromObject(nodes[0]);
     }
-    for (auto node : nodes) {
+    for (const auto& node : nodes) {
         if (Is<Symbol>(node)) {
-            if (operations.find(As<Symbol>(node)->GetName()) != operations.end()) {
+            const std::string& name = As<Symbol>(node)->GetName();
+            auto factory = operations.find(name);
+            if (factory != operations.end()) {
                 if (st_op.empty()) {
-                    std::shared_ptr<Object> operation = operations[As<Symbol>(node)->GetName()]();
+                    Ref<Object> operation = factory->second();
                     st_op.push_back(operation);
-                    if (As<Symbol>(node)->GetName() != "car" &&
-                        As<Symbol>(node)->GetName() != "cdr") {
-                        st_res.push_back(operation->Apply(nullptr));
+                    if (name != "car" && name != "cdr") {
+                        st_res.push_back(operation->Apply(Value::Nil()));
                     } else {
-                        st_res.push_back(
-                            operation->Apply(std::shared_ptr<Object>(new Symbol("nullptr"))));
+                        st_res.push_back(operation->Apply(NullptrMarker()));
                     }
                 } else {
                     st_res.pop_back();
-                    st_res.push_back(st_op.back()->Apply(node));
+                    st_res.push_back(st_op.back()->Apply(Value::FromObject(node)));
                 }
             } else {
                 if (!st_op.empty()) {
                     // проверка на ошибки
                     if (st_res.empty()) {
-                        st_res.push_back(st_op.back()->Apply(node));
+                        st_res.push_back(st_op.back()->Apply(Value::FromObject(node)));
                     } else {
                         st_res.pop_back();
-                        st_res.push_back(st_op.back()->Apply(node));
+                        st_res.push_back(st_op.back()->Apply(Value::FromObject(node)));
                     }
                 } else {
                     throw RuntimeError{"expression cannot be evaluated"};
@@ -46,20 +67,21 @@ std::shared_ptr<Object> Interpreter::Evaluate(std::vector<std::shared_ptr<Object
             // проверка на ошибки
             if (!st_res.empty()) {
                 st_res.pop_back();
-                st_res.push_back(st_op.back()->Apply(node));
+                st_res.push_back(st_op.back()->Apply(Value::FromObject(node)));
             }
         }
+        heap.Safepoint();
     }
     if (!st_op.empty()) {
         st_op.back().reset();
         st_op.pop_back();
     }
     while (!st_op.empty()) {
-        std::shared_ptr<Object> curr_operation = st_op.back();
+        Ref<Object> curr_operation = st_op.back();
         st_op.back().reset();
         st_op.pop_back();
         if (!st_res.empty()) {
-            std::shared_ptr<Object> last_res = st_res.back();
+            Value last_res = st_res.back();
             st_res.pop_back();
             st_res.push_back(curr_operation->Apply(last_res));
         } else {
@@ -71,39 +93,37 @@ std::shared_ptr<Object> Interpreter::Evaluate(std::vector<std::shared_ptr<Object
     }
     return st_res.back();
 }
-void Interpreter::AstToVector(std::shared_ptr<Object> node,
-                              std::vector<std::shared_ptr<Object>>& result) {
-    if (Is<Cell>(node)) {
-        if (As<Cell>(node)->GetFirst() == nullptr && As<Cell>(node)->GetSecond() == nullptr) {
-            result.push_back(node);
+void Interpreter::AstToVector(Ref<Object> node, std::vector<Ref<Object>>& result) {
+    // Only cars are visited recursively; the cdrs are followed in a loop, so
+    // a long form needs no stack per element.
+    while (node != nullptr) {
+        if (node->Type() != ObjectType::CELL) {
+            result.push_back(std::move(node));
             return;
         }
-        if (Is<Symbol>(As<Cell>(node)->GetFirst())) {
-            if (As<Symbol>(As<Cell>(node)->GetFirst())->GetName() == "quote") {
-                if (As<Cell>(node)->GetFirst() != nullptr) {
-                    result.push_back(As<Cell>(node)->GetFirst());
-                }
-                if (As<Cell>(node)->GetSecond() != nullptr) {
-                    result.push_back(As<Cell>(node)->GetSecond());
-                }
-                return;
-            }
+        const Cell& cell = static_cast<const Cell&>(*node);
+        const Ref<Object>& first = cell.GetFirst();
+        const Ref<Object>& second = cell.GetSecond();
+        if (first == nullptr && second == nullptr) {
+            result.push_back(std::move(node));
+            return;
         }
-        AstToVector(As<Cell>(node)->GetFirst(), result);
-        AstToVector(As<Cell>(node)->GetSecond(), result);
-        return;
-    } else {
-        if (node != nullptr) {
-            result.push_back(node);
+        if (Is<Symbol>(first) && As<Symbol>(first)->GetName() == "quote") {
+            result.push_back(first);
+            if (second != nullptr) {
+                result.push_back(second);
+            }
+            return;
         }
-        return;
+        AstToVector(first, result);
+        Ref<Object> rest = second;
+        node = std::move(rest);
     }
 }
-
-void Interpreter::SerializeQuote(std::shared_ptr<Object> node, std::string& result) {
-    if (Is<Cell>(node)) {
-        std::shared_ptr<Object> left = As<Cell>(node)->GetFirst(),
-                                right = As<Cell>(node)->GetSecond();
+void Interpreter::SerializeQuote(Ref<Object> node, std::string& result) {
+    // Follows the cdrs in a loop, so a long list needs no stack per element.
+    while (Is<Cell>(node)) {
+        Ref<Object> left = As<Cell>(node)->GetFirst(), right = As<Cell>(node)->GetSecond();
         if (left != nullptr && !Is<Cell>(right) && right != nullptr) {
             result += left->Serialize() + ". " + right->Serialize();
             if (std::isspace(result.back())) {
@@ -116,7 +136,7 @@ void Interpreter::SerializeQuote(std::shared_ptr<Object> node, std::string& resu
             if (Is<Symbol>(left)) {
                 result += " ";
             }
-            SerializeQuote(right, result);
+            node = std::move(right);
         } else if (left != nullptr && right == nullptr) {
             result += left->Serialize();
             if (std::isspace(result.back())) {
@@ -128,17 +148,16 @@ void Interpreter::SerializeQuote(std::shared_ptr<Object> node, std::string& resu
             result += "())";
             return;
         }
+    }
+    if (node != nullptr) {
+        result += node->Serialize() + ' ';
     } else {
-        if (node != nullptr) {
-            result += node->Serialize() + ' ';
-        } else {
-            result += ")";
-        }
+        result += ")";
     }
 }
 
-void Interpreter::Serialize(std::vector<std::shared_ptr<Object>>& nodes,
-                            std::vector<std::shared_ptr<Object>>& original, std::string& result) {
+void Interpreter::Serialize(std::vector<Ref<Object>>& nodes, std::vector<Ref<Object>>& original,
+                            std::string& result) {
     if (!original.empty() && (Is<Symbol>(original[0]) || Is<Cell>(original[0]))) {
         if (As<Symbol>(original[0])->GetName() == "quote") {
             if (original.size() > 1) {
@@ -167,104 +186,122 @@ void Interpreter::Serialize(std::vector<std::shared_ptr<Object>>& nodes,
         result = "()";
         return;
     }
-    std::shared_ptr<Object> prev;
+    Ref<Object> prev;
     for (size_t i = 0; i < nodes.size(); ++i) {
-        if (Is<Cell>(nodes[i])) {
-            result += "(())";
-        } else if (Is<Symbol>(nodes[i])) {
-            if (As<Symbol>(nodes[i])->GetName() == "quote") {
-                result += "(quote ";
-            } else {
-                if (nodes.size() == 1) {
-                    result += nodes[i]->Serialize();
-                } else if (nodes.size() > 1) {
-                    if (result.empty()) {
-                        result += "(" + nodes[i]->Serialize() + " ";
-                    } else {
-                        result += nodes[i]->Serialize() + " ";
-                        if (i == nodes.size() - 1) {
-                            if (std::isspace(result.back())) {
-                                result.pop_back();
+        switch (nodes[i]->Type()) {
+            case ObjectType::CELL:
+                result += "(())";
+                break;
+            case ObjectType::SYMBOL:
+                if (As<Symbol>(nodes[i])->GetName() == "quote") {
+                    result += "(quote ";
+                } else {
+                    if (nodes.size() == 1) {
+                        result += nodes[i]->Serialize();
+                    } else if (nodes.size() > 1) {
+                        if (result.empty()) {
+                            result += "(" + nodes[i]->Serialize() + " ";
+                        } else {
+                            result += nodes[i]->Serialize() + " ";
+                            if (i == nodes.size() - 1) {
+                                if (std::isspace(result.back())) {
+                                    result.pop_back();
+                                }
+                                result.push_back(')');
                             }
-                            result.push_back(')');
                         }
                     }
                 }
-            }
-        } else {
-            size_t j = i;
-            size_t cnt = 0;
-            while (j < nodes.size() && Is<Number>(nodes[j])) {
-                ++j;
-                ++cnt;
-            }
-            if (cnt == 1 && Is<Number>(prev)) {
-                result += nodes[i]->Serialize();
-                if (std::isspace(result.back())) {
-                    result.pop_back();
-                }
-                result.push_back(')');
-            } else if (cnt == 1 && !Is<Number>(prev)) {
-                result += nodes[i]->Serialize();
-                if (std::isspace(result.back())) {
-                    result.pop_back();
+                break;
+            default: {
+                size_t j = i;
+                size_t cnt = 0;
+                while (j < nodes.size() && Is<Number>(nodes[j])) {
+                    ++j;
+                    ++cnt;
                 }
-            } else {
-                if (Is<Number>(prev)) {
+                if (cnt == 1 && Is<Number>(prev)) {
+                    result += nodes[i]->Serialize();
+                    if (std::isspace(result.back())) {
+                        result.pop_back();
+                    }
+                    result.push_back(')');
+                } else if (cnt == 1 && !Is<Number>(prev)) {
                     result += nodes[i]->Serialize();
+                    if (std::isspace(result.back())) {
+                        result.pop_back();
+                    }
                 } else {
-                    result += "(" + nodes[i]->Serialize();
+                    if (Is<Number>(prev)) {
+                        result += nodes[i]->Serialize();
+                    } else {
+                        result += "(" + nodes[i]->Serialize();
+                    }
                 }
+                break;
             }
         }
         prev = nodes[i];
     }
 }
 
-void Interpreter::IntegerTypeChecker(std::vector<Token>& tokens) {
-    bool have_question_qualifier = false;
-    bool quote_flag = false;
-    Token prev_token = 0;
-    for (size_t i = 0; i < tokens.size(); ++i) {
-        bool is_operation = false;
-        if (SymbolToken* x = std::get_if<SymbolToken>(&tokens[i])) {
-            if (x->name.back() == '?') {
-                have_question_qualifier = true;
-            }
-            if (x->name == "quote") {
-                quote_flag = true;
-            }
+void IntegerTypeChecker::OnToken(const Token& token) {
+    if (error_) {
+        return;
+    }
+    bool is_operation = false;
+    const SymbolToken* symbol = std::get_if<SymbolToken>(&token);
+    if (symbol) {
+        if (symbol->name.back() == '?') {
+            have_question_qualifier_ = true;
         }
-        if (tokens[i] == Token{QuoteToken()}) {
-            quote_flag = true;
+        if (symbol->name == "quote") {
+            quote_flag_ = true;
         }
-        if (SymbolToken* x = std::get_if<SymbolToken>(&tokens[i])) {
-            if (operations.find(x->name) == operations.end()) {
-                if (!have_question_qualifier) {
-                    throw RuntimeError{"not an operation cannot be used in arithmetic expression"};
-                }
-            } else {
-                is_operation = true;
+    }
+    if (std::holds_alternative<QuoteToken>(token)) {
+        quote_flag_ = true;
+    }
+    if (symbol) {
+        if (operations_.find(symbol->name) == operations_.end()) {
+            if (!have_question_qualifier_) {
+                error_ = "not an operation cannot be used in arithmetic expression";
+                return;
             }
+        } else {
+            is_operation = true;
         }
-        if (ConstantToken* y = std::get_if<ConstantToken>(&tokens[i])) {
-            prev_token = tokens[i];
-            continue;
-        }
-        if (!quote_flag && tokens[i] == Token{BracketToken::CLOSE} &&
-            prev_token == Token{BracketToken::OPEN}) {
-            throw RuntimeError{
-                "not an operation or number cannot be used in arithmetic expression"};
-        }
-        if (!is_operation && !quote_flag && !have_question_qualifier &&
-            (tokens[i] != Token{BracketToken::OPEN} && tokens[i] != Token{BracketToken::CLOSE})) {
-            throw RuntimeError{"not an operation cannot be used in arithmetic expression"};
-        }
-        prev_token = tokens[i];
+    }
+    if (std::holds_alternative<ConstantToken>(token)) {
+        prev_is_open_ = false;
+        return;
+    }
+    const BracketToken* bracket = std::get_if<BracketToken>(&token);
+    if (!quote_flag_ && bracket && *bracket == BracketToken::CLOSE && prev_is_open_) {
+        error_ = "not an operation or number cannot be used in arithmetic expression";
+        return;
+    }
+    if (!is_operation && !quote_flag_ && !have_question_qualifier_ && !bracket) {
+        error_ = "not an operation cannot be used in arithmetic expression";
+        return;
+    }
+    prev_is_open_ = bracket && *bracket == BracketToken::OPEN;
+}
+
+void IntegerTypeChecker::Reset() {
+    error_ = nullptr;
+    have_question_qualifier_ = false;
+    quote_flag_ = false;
+    prev_is_open_ = false;
+}
+
+void IntegerTypeChecker::Check() const {
+    if (error_) {
+        throw RuntimeError{error_};
     }
 }
 
-void Interpreter::BinaryOperationsChecker(std::vector<std::shared_ptr<Object>>& nodes) {
+void Interpreter::BinaryOperationsChecker(std::vector<Ref<Object>>& nodes) {
     for (size_t i = 0; i < nodes.size(); ++i) {
         bool is_binary = false;
         if (Is<Symbol>(nodes[i])) {
@@ -286,7 +323,7 @@ void Interpreter::BinaryOperationsChecker(std::vector<std::shared_ptr<Object>>&
     }
 }
 
-void Interpreter::UnaryOperationChecker(std::vector<std::shared_ptr<Object>>& nodes) {
+void Interpreter::UnaryOperationChecker(std::vector<Ref<Object>>& nodes) {
     for (size_t i = 0; i < nodes.size(); ++i) {
         bool is_unary = false;
         if (Is<Symbol>(nodes[i])) {
@@ -313,7 +350,7 @@ void Interpreter::UnaryOperationChecker(std::vector<std::shared_ptr<Object>>& no
     }
 }
 
-void Interpreter::RequiresOnlyOneArgumentChecker(std::vector<std::shared_ptr<Object>>& nodes) {
+void Interpreter::RequiresOnlyOneArgumentChecker(std::vector<Ref<Object>>& nodes) {
     for (size_t i = 0; i < nodes.size(); ++i) {
         bool requires_only_one = false;
         bool is_not = false;
@@ -347,30 +384,36 @@ void Interpreter::RequiresOnlyOneArgumentChecker(std::vector<std::shared_ptr<Obj
     }
 }
 
-void Interpreter::ListsAreNotSelfEvaluating(std::vector<Token>& tokens) {
-    bool has_operation = false;
-    bool has_brackets = false;
-    for (size_t i = 0; i < tokens.size(); ++i) {
-        if (tokens[i] == Token{BracketToken::OPEN}) {
-            has_brackets = true;
-        }
-        if (SymbolToken* x = std::get_if<SymbolToken>(&tokens[i])) {
-            if (operations.find(x->name) != operations.end()) {
-                has_operation = true;
-            }
-        }
-        if (tokens[i] == Token{QuoteToken()}) {
-            has_operation = true;
+void ListsAreNotSelfEvaluating::OnToken(const Token& token) {
+    if (token == Token{BracketToken::OPEN}) {
+        has_brackets_ = true;
+    }
+    if (const SymbolToken* x = std::get_if<SymbolToken>(&token)) {
+        if (operations_.find(x->name) != operations_.end()) {
+            has_operation_ = true;
         }
     }
-    if (has_brackets && !has_operation) {
+    if (std::holds_alternative<QuoteToken>(token)) {
+        has_operation_ = true;
+    }
+}
+
+void ListsAreNotSelfEvaluating::Reset() {
+    has_operation_ = false;
+    has_brackets_ = false;
+}
+
+void ListsAreNotSelfEvaluating::Check() const {
+    if (has_brackets_ && !has_operation_) {
         throw RuntimeError{"Lists Are Not Self Evaluating"};
     }
 }
 
-std::shared_ptr<Object> Interpreter::AndEvaluate(std::vector<std::shared_ptr<Object>>& nodes) {
-    std::vector<std::shared_ptr<Object>> curr_test;
-    std::shared_ptr<Object> last_result;
+Ref<Object> Interpreter::AndEvaluate(std::vector<Ref<Object>>& nodes) {
+    ValueScope scope{gc_options_, &gc_stats_};
+    ValueRoots roots;
+    std::vector<Ref<Object>> curr_test;
+    Value& last_result = roots.values.emplace_back();
     size_t i = 1, j = 0;
     while (i < nodes.size()) {
         if (Is<Symbol>(nodes[i])) {
@@ -386,43 +429,39 @@ std::shared_ptr<Object> Interpreter::AndEvaluate(std::vector<std::shared_ptr<Obj
                     ++j;
                 }
                 i = j;
-                std::shared_ptr<Object> result = Evaluate(curr_test);
-                if (Is<Symbol>(result)) {
-                    if (As<Symbol>(result)->GetName() == "#f") {
-                        return result;
-                    } else {
-                        last_result = result;
-                    }
-                } else {
-                    last_result = result;
+                Value result = EvaluateValue(curr_test);
+                if (result.IsFalse()) {
+                    return result.ToObject();
                 }
+                last_result = result;
             } else {
                 curr_test.push_back(nodes[i]);
-                std::shared_ptr<Object> result = Evaluate(curr_test);
+                Value result = EvaluateValue(curr_test);
                 ++i;
-                if (As<Symbol>(result)->GetName() == "#f") {
-                    return result;
-                } else {
-                    last_result = result;
+                if (result.IsFalse()) {
+                    return result.ToObject();
                 }
+                last_result = result;
             }
         } else if (Is<Number>(nodes[i])) {
             curr_test.clear();
             curr_test.push_back(nodes[i]);
-            std::shared_ptr<Object> result = Evaluate(curr_test);
+            Value result = EvaluateValue(curr_test);
             last_result = result;
             ++i;
         }
     }
     if (nodes.size() == 1) {
-        return std::shared_ptr<Object>(new Symbol("#t"));
+        return BooleanObject(true);
     }
-    return last_result;
+    return last_result.ToObject();
 }
 
-std::shared_ptr<Object> Interpreter::OrEvaluate(std::vector<std::shared_ptr<Object>>& nodes) {
-    std::vector<std::shared_ptr<Object>> curr_test;
-    std::shared_ptr<Object> last_result;
+Ref<Object> Interpreter::OrEvaluate(std::vector<Ref<Object>>& nodes) {
+    ValueScope scope{gc_options_, &gc_stats_};
+    ValueRoots roots;
+    std::vector<Ref<Object>> curr_test;
+    Value& last_result = roots.values.emplace_back();
     size_t i = 1, j = 0;
     while (i < nodes.size()) {
         if (Is<Symbol>(nodes[i])) {
@@ -438,50 +477,156 @@ std::shared_ptr<Object> Interpreter::OrEvaluate(std::vector<std::shared_ptr<Obje
                     ++j;
                 }
                 i = j;
-                std::shared_ptr<Object> result = Evaluate(curr_test);
-                if (Is<Symbol>(result)) {
-                    if (As<Symbol>(result)->GetName() == "#t") {
-                        return result;
-                    } else {
-                        last_result = result;
-                    }
-                } else {
-                    last_result = result;
+                Value result = EvaluateValue(curr_test);
+                if (result.IsTrue()) {
+                    return result.ToObject();
                 }
+                last_result = result;
             } else {
                 curr_test.push_back(nodes[i]);
-                std::shared_ptr<Object> result = Evaluate(curr_test);
+                Value result = EvaluateValue(curr_test);
                 ++i;
-                if (As<Symbol>(result)->GetName() == "#t") {
-                    return result;
-                } else {
-                    last_result = result;
+                if (result.IsTrue()) {
+                    return result.ToObject();
                 }
+                last_result = result;
             }
         } else if (Is<Number>(nodes[i])) {
             curr_test.clear();
             curr_test.push_back(nodes[i]);
-            std::shared_ptr<Object> result = Evaluate(curr_test);
+            Value result = EvaluateValue(curr_test);
             last_result = result;
             ++i;
         }
     }
     if (nodes.size() == 1) {
-        return std::shared_ptr<Object>(new Symbol("#f"));
+        return BooleanObject(false);
     }
-    return last_result;
+    return last_result.ToObject();
 }
 
-std::string Interpreter::Run(const std::string& str) {
-    std::stringstream ss{str};
-    Tokenizer tokenizer{&ss};
-    std::string result;
-    std::shared_ptr<Object> ast = Read((&tokenizer));
-    std::vector<Token>& tokens = tokenizer.GetAllTokens();
-    std::vector<std::shared_ptr<Object>> v;
+Interpreter::FormContext::FormContext(const OperationTable& operations)
+    : tokenizer(std::string_view{}, false),
+      integer_type_checker(operations),
+      lists_are_not_self_evaluating(operations) {
+    tokenizer.AddListener(&integer_type_checker);
+    tokenizer.AddListener(&lists_are_not_self_evaluating);
+}
+
+void Interpreter::FormContext::Start(std::string_view source) {
+    integer_type_checker.Reset();
+    lists_are_not_self_evaluating.Reset();
+    tokenizer.Reset(source);
+}
+
+std::string Interpreter::Run(std::string_view str) {
+    std::optional<FormContext> context;
+    return RunForm(context, str);
+}
+
+void Interpreter::RunProgram(std::istream& in, const ResultCallback& emit) {
+    std::optional<FormContext> context;
+    IncrementalReader reader;
+    std::string chunk(64 * 1024, '\0');
+    while (in) {
+        in.read(chunk.data(), chunk.size());
+        reader.Feed(std::string_view{chunk}.substr(0, in.gcount()));
+        while (auto source = reader.TryReadSource()) {
+            emit(RunForm(context, *source));
+        }
+    }
+    reader.Finish();
+    while (auto source = reader.TryReadSource()) {
+        emit(RunForm(context, *source));
+    }
+}
+
+std::vector<std::string> Interpreter::RunProgram(std::istream& in) {
+    std::vector<std::string> results;
+    RunProgram(in, [&results](const std::string& result) { results.push_back(result); });
+    return results;
+}
+
+void Interpreter::RunFile(const std::string& path, const ResultCallback& emit) {
+    MappedFile file{path};
+    std::optional<FormContext> context;
+    RunForms(context, file.View(), emit);
+}
+
+std::vector<std::string> Interpreter::RunFile(const std::string& path) {
+    std::vector<std::string> results;
+    RunFile(path, [&results](const std::string& result) { results.push_back(result); });
+    return results;
+}
+
+void Interpreter::RunForms(std::optional<FormContext>& context, std::string_view source,
+                           const ResultCallback& emit) {
+    size_t begin = 0;
+    auto run = [&](size_t end) {
+        std::string_view form = source.substr(begin, end - begin);
+        begin = end;
+        emit(RunForm(context, form));
+    };
+    DatumScanner scanner;
+    scanner.Scan(source, 0, run);
+    if (scanner.Finish()) {
+        run(source.size());
+    }
+}
+
+void Interpreter::SetParseCacheCapacity(size_t forms) {
+    parse_cache_.SetCapacity(forms);
+}
+
+const ParseCacheStats& Interpreter::GetParseCacheStats() const {
+    return parse_cache_.Stats();
+}
+
+void Interpreter::SetGcOptions(const GcOptions& options) {
+    gc_options_ = options;
+}
+
+const GcStats& Interpreter::GetGcStats() const {
+    return gc_stats_;
+}
+
+void Interpreter::Define(const std::string& name, OperationFactory factory) {
+    operations.insert_or_assign(name, std::move(factory));
+    InvalidateParseCache();
+}
+
+void Interpreter::InvalidateParseCache() {
+    parse_cache_.Invalidate();
+}
+
+std::string Interpreter::RunForm(std::optional<FormContext>& context, std::string_view source) {
+    std::shared_ptr<const ParsedForm> form = parse_cache_.Find(source);
+    if (!form) {
+        if (!context) {
+            context.emplace(operations);
+        }
+        context->Start(source);
+        form = ParseForm(*context);
+        parse_cache_.Insert(source, form);
+    }
+    return EvaluateForm(*form);
+}
+
+std::shared_ptr<const ParsedForm> Interpreter::ParseForm(FormContext& context) {
+    Tokenizer& tokenizer = context.tokenizer;
+    IntegerTypeChecker& integer_type_checker = context.integer_type_checker;
+    ListsAreNotSelfEvaluating& lists_are_not_self_evaluating = context.lists_are_not_self_evaluating;
+    // The nodes of a form share one arena, which lives as long as any of them.
+    ParseArena arena;
+    Ref<Object> ast;
+    {
+        ParseArena::Scope scope{arena};
+        ast = Read(&tokenizer);
+    }
+    std::vector<Ref<Object>> v;
     AstToVector(ast, v);
     if (v.size() == 1 && Is<Symbol>(v[0])) {
-        if (As<Symbol>(v[0])->GetName() != "#t" && As<Symbol>(v[0])->GetName() != "#f") {
+        if (v[0] != BooleanObject(true) && v[0] != BooleanObject(false)) {
             if (operations.find(As<Symbol>(v[0])->GetName()) == operations.end()) {
                 throw RuntimeError{"Symbol cannot be evaluated"};
             }
@@ -491,17 +636,23 @@ std::string Interpreter::Run(const std::string& str) {
             std::string operation = As<Symbol>(v[0])->GetName();
             if (operation != "not" && operation != "boolean?" && operation != "number?" &&
                 operation != "and" && operation != "or") {
-                IntegerTypeChecker(tokens);
+                integer_type_checker.Check();
             }
         } else {
-            IntegerTypeChecker(tokens);
+            integer_type_checker.Check();
         }
     }
     BinaryOperationsChecker(v);
     UnaryOperationChecker(v);
     RequiresOnlyOneArgumentChecker(v);
-    ListsAreNotSelfEvaluating(tokens);
-    std::shared_ptr<Object> evaluated_ast;
+    lists_are_not_self_evaluating.Check();
+    return std::make_shared<const ParsedForm>(ParsedForm{std::move(ast), std::move(v)});
+}
+
+std::string Interpreter::EvaluateForm(const ParsedForm& form) {
+    std::vector<Ref<Object>> v = form.nodes;
+    std::string result;
+    Ref<Object> evaluated_ast;
     // Integer evaluation or smth else evaluation
     if (v.empty() ||
         (!v.empty() && Is<Symbol>(v[0]) &&
@@ -521,25 +672,24 @@ std::string Interpreter::Run(const std::string& str) {
             evaluated_ast = Evaluate(v);
         }
     }
-    std::vector<std::shared_ptr<Object>> v_evaluated;
+    std::vector<Ref<Object>> v_evaluated;
     AstToVector(evaluated_ast, v_evaluated);
     if (Is<Cell>(evaluated_ast) && As<Cell>(evaluated_ast)->GetSecond() != nullptr) {
-        std::shared_ptr<CheckIfList> checker = std::shared_ptr<CheckIfList>(new CheckIfList());
-        std::shared_ptr<Object> res = checker->Apply(evaluated_ast);
-        if (Is<Symbol>(res) && As<Symbol>(res)->GetName() == "#f") {
+        Ref<CheckIfList> checker = Ref<CheckIfList>(new CheckIfList());
+        if (checker->Apply(Value::FromObject(evaluated_ast)).IsFalse()) {
             result.push_back('(');
             SerializeQuote(evaluated_ast, result);
             return result;
         }
     }
-    std::shared_ptr<CheckIfList> checker = std::shared_ptr<CheckIfList>(new CheckIfList());
-    std::shared_ptr<Object> res = checker->Apply(evaluated_ast);
+    Ref<CheckIfList> checker = Ref<CheckIfList>(new CheckIfList());
+    Value res = checker->Apply(Value::FromObject(evaluated_ast));
     if (!v.empty() && Is<Symbol>(v[0]) && As<Symbol>(v[0])->GetName() != "quote" &&
-        Is<Symbol>(res) && As<Symbol>(res)->GetName() == "#t") {
+        res.IsTrue()) {
         result.push_back('(');
         SerializeQuote(evaluated_ast, result);
         return result;
     }
     Serialize(v_evaluated, v, result);
     return result;
-}
\ No newline at end of file
+}
@@ -3,59 +3,149 @@
 #include <string>
 #include "unordered_map"
 #include "parser.h"
+#include "parse_cache.h"
 #include "map"
 #include "vector"
 #include "deque"
 #include "sstream"
 #include "functional"
+#include "optional"
+
+using OperationFactory = std::function<Ref<Object>()>;
+using OperationTable = std::map<const std::string, OperationFactory, std::less<>>;
+
+// Token-level checks run while the tokenizer streams; the first violation is
+// remembered and reported by Check() once the interpreter decides it applies.
+class IntegerTypeChecker : public TokenListener {
+public:
+    explicit IntegerTypeChecker(const OperationTable& operations) : operations_(operations){};
+
+    void OnToken(const Token& token) override;
+    void Check() const;
+    void Reset();
+
+private:
+    const OperationTable& operations_;
+    const char* error_ = nullptr;
+    bool have_question_qualifier_ = false;
+    bool quote_flag_ = false;
+    bool prev_is_open_ = false;
+};
+
+class ListsAreNotSelfEvaluating : public TokenListener {
+public:
+    explicit ListsAreNotSelfEvaluating(const OperationTable& operations)
+        : operations_(operations){};
+
+    void OnToken(const Token& token) override;
+    void Check() const;
+    void Reset();
+
+private:
+    const OperationTable& operations_;
+    bool has_operation_ = false;
+    bool has_brackets_ = false;
+};
 
 class Interpreter {
 public:
-    std::string Run(const std::string&);
-
-    std::map<const std::string, std::function<std::shared_ptr<Object>()>> operations{
-        {"quote", []() { return std::shared_ptr<Object>(new QuoteOperation()); }},
-        {"number?", []() { return std::shared_ptr<Object>(new CheckIfNumber()); }},
-        {"=", []() { return std::shared_ptr<Object>(new CheckIfEqual()); }},
-        {"+", []() { return std::shared_ptr<Object>(new AddOperation()); }},
-        {"<", []() { return std::shared_ptr<Object>(new CheckIfLess()); }},
-        {"<=", []() { return std::shared_ptr<Object>(new CheckIfLessOrEqual()); }},
-        {">", []() { return std::shared_ptr<Object>(new CheckIfGreater()); }},
-        {">=", []() { return std::shared_ptr<Object>(new CheckIfGreaterOrEqual()); }},
-        {"-", []() { return std::shared_ptr<Object>(new MinusOperation()); }},
-        {"/", []() { return std::shared_ptr<Object>(new DivisionOperation()); }},
-        {"*", []() { return std::shared_ptr<Object>(new MultiplicationOperation()); }},
-        {"max", []() { return std::shared_ptr<Object>(new MaxOperation()); }},
-        {"min", []() { return std::shared_ptr<Object>(new MinOperation()); }},
-        {"abs", []() { return std::shared_ptr<Object>(new AbsOperation()); }},
-        {"boolean?", []() { return std::shared_ptr<Object>(new CheckIfBoolean()); }},
-        {"not", []() { return std::shared_ptr<Object>(new NotOperation()); }},
-        {"and", []() { return std::shared_ptr<Object>(new AndOperation()); }},
-        {"or", []() { return std::shared_ptr<Object>(new OrOperation()); }},
-        {"null?", []() { return std::shared_ptr<Object>(new CheckIfNull()); }},
-        {"list?", []() { return std::shared_ptr<Object>(new CheckIfList()); }},
-        {"pair?", []() { return std::shared_ptr<Object>(new CheckIfPair()); }},
-        {"cons", []() { return std::shared_ptr<Object>(new ConstructOperation()); }},
-        {"car", []() { return std::shared_ptr<Object>(new CarOperation()); }},
-        {"cdr", []() { return std::shared_ptr<Object>(new CdrOperation()); }},
-        {"list", []() { return std::shared_ptr<Object>(new ListOperation()); }},
-        {"list-ref", []() { return std::shared_ptr<Object>(new ListRefOperation()); }},
-        {"list-tail", []() { return std::shared_ptr<Object>(new ListTailOperation()); }}
+    std::string Run(std::string_view);
+
+    using ResultCallback = std::function<void(const std::string&)>;
+
+    // Evaluates every top-level form in order and emits each result as soon as
+    // the form is done. The first failing form stops the program by throwing.
+    // The input is read in chunks, so memory does not grow with its length.
+    void RunProgram(std::istream& in, const ResultCallback& emit);
+    std::vector<std::string> RunProgram(std::istream& in);
+
+    // Same, for the file at path, which is mapped instead of read.
+    void RunFile(const std::string& path, const ResultCallback& emit);
+    std::vector<std::string> RunFile(const std::string& path);
+
+    // Remembers the checked parse of up to `forms` distinct form sources and
+    // reuses it when the same text is run again. Zero, the default, turns the
+    // cache off.
+    void SetParseCacheCapacity(size_t forms);
+    const ParseCacheStats& GetParseCacheStats() const;
+
+    // Adds or replaces an operation. The checkers consult the operation
+    // table, so every cached parse is dropped; code that edits `operations`
+    // directly must call InvalidateParseCache() itself.
+    void Define(const std::string& name, OperationFactory factory);
+    void InvalidateParseCache();
+
+    // Objects created while a form is evaluated are collected once there are
+    // enough of them; see ValueScope. The stats add up over every form.
+    void SetGcOptions(const GcOptions& options);
+    const GcStats& GetGcStats() const;
+
+    OperationTable operations{
+        {"quote", []() { return Ref<Object>(new QuoteOperation()); }},
+        {"number?", []() { return Ref<Object>(new CheckIfNumber()); }},
+        {"=", []() { return Ref<Object>(new CheckIfEqual()); }},
+        {"+", []() { return Ref<Object>(new AddOperation()); }},
+        {"<", []() { return Ref<Object>(new CheckIfLess()); }},
+        {"<=", []() { return Ref<Object>(new CheckIfLessOrEqual()); }},
+        {">", []() { return Ref<Object>(new CheckIfGreater()); }},
+        {">=", []() { return Ref<Object>(new CheckIfGreaterOrEqual()); }},
+        {"-", []() { return Ref<Object>(new MinusOperation()); }},
+        {"/", []() { return Ref<Object>(new DivisionOperation()); }},
+        {"*", []() { return Ref<Object>(new MultiplicationOperation()); }},
+        {"max", []() { return Ref<Object>(new MaxOperation()); }},
+        {"min", []() { return Ref<Object>(new MinOperation()); }},
+        {"abs", []() { return Ref<Object>(new AbsOperation()); }},
+        {"boolean?", []() { return Ref<Object>(new CheckIfBoolean()); }},
+        {"not", []() { return Ref<Object>(new NotOperation()); }},
+        {"and", []() { return Ref<Object>(new AndOperation()); }},
+        {"or", []() { return Ref<Object>(new OrOperation()); }},
+        {"null?", []() { return Ref<Object>(new CheckIfNull()); }},
+        {"list?", []() { return Ref<Object>(new CheckIfList()); }},
+        {"pair?", []() { return Ref<Object>(new CheckIfPair()); }},
+        {"cons", []() { return Ref<Object>(new ConstructOperation()); }},
+        {"car", []() { return Ref<Object>(new CarOperation()); }},
+        {"cdr", []() { return Ref<Object>(new CdrOperation()); }},
+        {"list", []() { return Ref<Object>(new ListOperation()); }},
+        {"list-ref", []() { return Ref<Object>(new ListRefOperation()); }},
+        {"list-tail", []() { return Ref<Object>(new ListTailOperation()); }}
 
     };
 
-    void AstToVector(std::shared_ptr<Object>, std::vector<std::shared_ptr<Object>>&);
-    std::shared_ptr<Object> Evaluate(std::vector<std::shared_ptr<Object>>);
-    void Serialize(std::vector<std::shared_ptr<Object>>&, std::vector<std::shared_ptr<Object>>&,
-                   std::string&);
-    std::shared_ptr<Object> AndEvaluate(std::vector<std::shared_ptr<Object>>&);
-    std::shared_ptr<Object> OrEvaluate(std::vector<std::shared_ptr<Object>>&);
+    void AstToVector(Ref<Object>, std::vector<Ref<Object>>&);
+    Ref<Object> Evaluate(std::vector<Ref<Object>>);
+    void Serialize(std::vector<Ref<Object>>&, std::vector<Ref<Object>>&, std::string&);
+    Ref<Object> AndEvaluate(std::vector<Ref<Object>>&);
+    Ref<Object> OrEvaluate(std::vector<Ref<Object>>&);
 
 private:
-    void IntegerTypeChecker(std::vector<Token>&);
-    void BinaryOperationsChecker(std::vector<std::shared_ptr<Object>>&);
-    void UnaryOperationChecker(std::vector<std::shared_ptr<Object>>&);
-    void RequiresOnlyOneArgumentChecker(std::vector<std::shared_ptr<Object>>&);
-    void ListsAreNotSelfEvaluating(std::vector<Token>&);
-    void SerializeQuote(std::shared_ptr<Object>, std::string&);
+    // One tokenizer and one set of token checkers serve every form of a program.
+    struct FormContext {
+        explicit FormContext(const OperationTable& operations);
+
+        // Resets the checkers, then points the tokenizer at the next form.
+        void Start(std::string_view source);
+
+        Tokenizer tokenizer;
+        IntegerTypeChecker integer_type_checker;
+        ListsAreNotSelfEvaluating lists_are_not_self_evaluating;
+    };
+
+    // Runs one form, taking its checked parse from the cache when possible.
+    // The context is only created once a form actually has to be parsed.
+    std::string RunForm(std::optional<FormContext>& context, std::string_view source);
+    std::shared_ptr<const ParsedForm> ParseForm(FormContext& context);
+    std::string EvaluateForm(const ParsedForm& form);
+    // Evaluate without boxing the result; the caller provides the ValueScope.
+    Value EvaluateValue(const std::vector<Ref<Object>>& nodes);
+    void RunForms(std::optional<FormContext>& context, std::string_view source,
+                  const ResultCallback& emit);
+
+    void BinaryOperationsChecker(std::vector<Ref<Object>>&);
+    void UnaryOperationChecker(std::vector<Ref<Object>>&);
+    void RequiresOnlyOneArgumentChecker(std::vector<Ref<Object>>&);
+    void SerializeQuote(Ref<Object>, std::string&);
+
+    ParseCache parse_cache_;
+    GcOptions gc_options_;
+    GcStats gc_stats_;
 };
\ No newline at end of file
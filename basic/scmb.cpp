@@ -0,0 +1,204 @@
+#include <scmb.h>
+#include "error.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+constexpr char kMagic[4] = {'S', 'C', 'M', 'B'};
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t nodes;
+    uint32_t roots;
+    uint32_t symbols;
+    uint64_t name_bytes;
+};
+
+static_assert(sizeof(Header) == 32);
+
+uint64_t Align(uint64_t offset) {
+    return (offset + 7) & ~uint64_t{7};
+}
+
+// Where each section starts, in file order.
+struct Layout {
+    explicit Layout(const Header& header) {
+        payload = Align(sizeof(Header));
+        first_child = Align(payload + uint64_t{header.nodes} * sizeof(int64_t));
+        next_sibling = Align(first_child + uint64_t{header.nodes} * sizeof(uint32_t));
+        roots = Align(next_sibling + uint64_t{header.nodes} * sizeof(uint32_t));
+        name_offsets = Align(roots + uint64_t{header.roots} * sizeof(uint32_t));
+        kinds = Align(name_offsets + (uint64_t{header.symbols} + 1) * sizeof(uint32_t));
+        names = Align(kinds + header.nodes);
+        end = names + header.name_bytes;
+    }
+
+    uint64_t payload, first_child, next_sibling, roots, name_offsets, kinds, names, end;
+};
+
+RuntimeError Corrupt(const std::string& path) {
+    return RuntimeError{"corrupt .scmb file: " + path};
+}
+
+// The links must describe a forest numbered in preorder with the right number
+// of children per kind; everything FlatAstView does relies on it. One
+// depth-first walk checks that the nodes are visited as 0, 1, 2, ...
+void ValidateTree(const FlatAstView& ast, const std::string& path) {
+    const size_t size = ast.Size();
+    std::span<const uint32_t> roots = ast.Roots();
+    std::vector<uint32_t> pending;
+    for (size_t j = roots.size(); j-- > 0;) {
+        if (roots[j] >= size) {
+            throw Corrupt(path);
+        }
+        uint32_t next = j + 1 == roots.size() ? FlatAstView::kNone : roots[j + 1];
+        if (ast.NextSibling(roots[j]) != next) {
+            throw Corrupt(path);
+        }
+        pending.push_back(roots[j]);
+    }
+    uint32_t expected = 0;
+    while (!pending.empty()) {
+        uint32_t node = pending.back();
+        pending.pop_back();
+        if (node != expected++ || node >= size) {
+            throw Corrupt(path);
+        }
+        size_t mark = pending.size();
+        for (uint32_t child = ast.FirstChild(node); child != FlatAstView::kNone;
+             child = ast.NextSibling(child)) {
+            // No node can be pending twice in a valid file.
+            if (child <= node || child >= size || pending.size() == size) {
+                throw Corrupt(path);
+            }
+            pending.push_back(child);
+        }
+        size_t children = pending.size() - mark;
+        std::reverse(pending.begin() + mark, pending.end());
+        bool valid = false;
+        switch (ast.Kind(node)) {
+            case NodeKind::INTEGER:
+                valid = children == 0;
+                break;
+            case NodeKind::SYMBOL:
+                valid = children == 0 && ast.GetInteger(node) >= 0 &&
+                        static_cast<uint64_t>(ast.GetInteger(node)) < ast.Names().size();
+                break;
+            case NodeKind::LIST:
+                valid = true;
+                break;
+            case NodeKind::DOTTED_LIST:
+                valid = children >= 2;
+                break;
+            case NodeKind::QUOTE:
+                valid = children == 1;
+                break;
+        }
+        if (!valid) {
+            throw Corrupt(path);
+        }
+    }
+    if (expected != size) {
+        throw Corrupt(path);
+    }
+}
+
+}  // namespace
+
+void WriteScmb(const FlatAstView& ast, const std::string& path) {
+    std::span<const std::string_view> names = ast.Names();
+    std::vector<uint32_t> name_offsets{0};
+    uint64_t name_bytes = 0;
+    for (std::string_view name : names) {
+        name_bytes += name.size();
+        if (name_bytes > UINT32_MAX) {
+            throw RuntimeError{"too many symbol names for a .scmb file"};
+        }
+        name_offsets.push_back(name_bytes);
+    }
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kScmbVersion;
+    header.byte_order = kByteOrderMark;
+    header.nodes = ast.Size();
+    header.roots = ast.Roots().size();
+    header.symbols = names.size();
+    header.name_bytes = name_bytes;
+    Layout layout{header};
+
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    uint64_t written = 0;
+    auto write = [&](uint64_t offset, const void* data, size_t size) {
+        static const char kPadding[8] = {};
+        out.write(kPadding, offset - written);
+        out.write(static_cast<const char*>(data), size);
+        written = offset + size;
+    };
+    write(0, &header, sizeof(header));
+    write(layout.payload, ast.Payloads(), header.nodes * sizeof(int64_t));
+    write(layout.first_child, ast.FirstChildren(), header.nodes * sizeof(uint32_t));
+    write(layout.next_sibling, ast.NextSiblings(), header.nodes * sizeof(uint32_t));
+    write(layout.roots, ast.Roots().data(), header.roots * sizeof(uint32_t));
+    write(layout.name_offsets, name_offsets.data(), name_offsets.size() * sizeof(uint32_t));
+    write(layout.kinds, ast.Kinds(), header.nodes);
+    write(layout.names, nullptr, 0);
+    for (std::string_view name : names) {
+        out.write(name.data(), name.size());
+    }
+    out.flush();
+    if (!out) {
+        throw RuntimeError{"cannot write " + path};
+    }
+}
+
+ScmbFile::ScmbFile(const std::string& path) : file_(path) {
+    std::string_view data = file_.View();
+    Header header;
+    if (data.size() < sizeof(header)) {
+        throw RuntimeError{"not a .scmb file: " + path};
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.byte_order != kByteOrderMark) {
+        throw RuntimeError{"not a .scmb file: " + path};
+    }
+    if (header.version != kScmbVersion) {
+        throw RuntimeError{"unsupported .scmb version " + std::to_string(header.version) + ": " +
+                           path};
+    }
+    Layout layout{header};
+    if (header.name_bytes > data.size() || layout.end != data.size()) {
+        throw Corrupt(path);
+    }
+
+    // The mapping is page aligned and every section starts at a multiple of 8.
+    const char* base = data.data();
+    auto section = [base](uint64_t offset) { return base + offset; };
+    const uint32_t* name_offsets = reinterpret_cast<const uint32_t*>(section(layout.name_offsets));
+    const char* name_bytes = section(layout.names);
+    if (name_offsets[0] != 0 || name_offsets[header.symbols] != header.name_bytes) {
+        throw Corrupt(path);
+    }
+    names_.reserve(header.symbols);
+    for (uint32_t id = 0; id < header.symbols; ++id) {
+        if (name_offsets[id + 1] < name_offsets[id]) {
+            throw Corrupt(path);
+        }
+        names_.emplace_back(name_bytes + name_offsets[id], name_offsets[id + 1] - name_offsets[id]);
+    }
+
+    view_ = FlatAstView(header.nodes, reinterpret_cast<const NodeKind*>(section(layout.kinds)),
+                        reinterpret_cast<const uint32_t*>(section(layout.first_child)),
+                        reinterpret_cast<const uint32_t*>(section(layout.next_sibling)),
+                        reinterpret_cast<const int64_t*>(section(layout.payload)),
+                        {reinterpret_cast<const uint32_t*>(section(layout.roots)), header.roots},
+                        names_);
+    ValidateTree(view_, path);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "flat_ast.h"
+#include "mapped_file.h"
+
+// The .scmb format: a FlatAst written out as it sits in memory, so loading
+// is a mapping plus a validation pass and the arrays are used in place.
+//
+// A 32-byte header is followed by sections, each starting at a multiple of
+// 8 bytes:
+//
+//   int64_t  payload[nodes]
+//   uint32_t first_child[nodes]
+//   uint32_t next_sibling[nodes]
+//   uint32_t roots[roots]
+//   uint32_t name_offsets[symbols + 1]   into the name bytes
+//   uint8_t  kinds[nodes]
+//   char     names[name_bytes]
+//
+// Numbers use the byte order of the machine that wrote the file; a file from
+// a machine with the other order is rejected, as is any other version.
+
+constexpr uint32_t kScmbVersion = 1;
+
+// Writes the whole tree to path.
+void WriteScmb(const FlatAstView& ast, const std::string& path);
+
+// A mapped .scmb file. Only the symbol names are unpacked, into one view
+// per distinct symbol; the node arrays are read straight from the mapping.
+class ScmbFile {
+public:
+    // Throws RuntimeError if the file cannot be mapped or is not a valid
+    // .scmb file of this version.
+    explicit ScmbFile(const std::string& path);
+
+    const FlatAstView& View() const {
+        return view_;
+    }
+
+private:
+    MappedFile file_;
+    std::vector<std::string_view> names_;
+    FlatAstView view_;
+};
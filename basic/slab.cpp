@@ -0,0 +1,211 @@
+#include <slab.h>
+#include "object.h"
+
+#include <mutex>
+
+// The pools of one thread that own slabs. When the thread exits, their
+// contents move to orphan pools, which the next pool of the same slot size
+// to run out of slots takes over.
+class ThreadPools {
+public:
+    ~ThreadPools() {
+        exiting = true;
+        std::lock_guard lock{orphans_mutex};
+        for (SlabPool* pool = pools; pool; pool = pool->next_pool_) {
+            // Orphan pools stay allocated even when empty, for the next
+            // thread to exit.
+            SlabPool* orphan = orphans;
+            while (orphan && orphan->slabs_) {
+                orphan = orphan->next_pool_;
+            }
+            if (!orphan) {
+                orphan = new SlabPool(pool->slot_size_);
+                orphan->next_pool_ = orphans;
+                orphans = orphan;
+            }
+            Move(*pool, *orphan);
+        }
+        pools = nullptr;
+    }
+
+    static void Register(SlabPool& pool) {
+        // Objects freed while the thread exits may still need a slab; those
+        // stay with the thread.
+        if (exiting) {
+            return;
+        }
+        // The first use constructs the hook for this thread.
+        pool.next_pool_ = instance.pools;
+        instance.pools = &pool;
+    }
+
+    // Gives pool, which has no slabs, those of an orphan of the same size.
+    static void Adopt(SlabPool& pool) {
+        std::lock_guard lock{orphans_mutex};
+        for (SlabPool* orphan = orphans; orphan; orphan = orphan->next_pool_) {
+            if (orphan->slabs_ && orphan->slot_size_ == pool.slot_size_) {
+                Move(*orphan, pool);
+                return;
+            }
+        }
+    }
+
+private:
+    // Moves the slabs and the counts of from to to, leaving from empty.
+    static void Move(SlabPool& from, SlabPool& to) {
+        to.slot_size_ = from.slot_size_;
+        to.current_ = std::exchange(from.current_, nullptr);
+        to.free_ = std::exchange(from.free_, nullptr);
+        to.next_ = std::exchange(from.next_, nullptr);
+        to.end_ = std::exchange(from.end_, nullptr);
+        to.partial_ = std::exchange(from.partial_, nullptr);
+        to.slabs_ = std::exchange(from.slabs_, nullptr);
+        to.inbox_ = std::exchange(from.inbox_, nullptr);
+        to.slab_count_ = std::exchange(from.slab_count_, 0);
+        to.allocations_ += std::exchange(from.allocations_, 0);
+        to.frees_ += std::exchange(from.frees_, 0);
+    }
+
+    static thread_local ThreadPools instance;
+    static thread_local constinit bool exiting;
+
+    static constinit std::mutex orphans_mutex;
+    static constinit SlabPool* orphans;
+
+    SlabPool* pools = nullptr;
+};
+
+thread_local ThreadPools ThreadPools::instance;
+thread_local constinit bool ThreadPools::exiting = false;
+constinit std::mutex ThreadPools::orphans_mutex;
+constinit SlabPool* ThreadPools::orphans = nullptr;
+
+void SlabPool::Free(void* slot) {
+    Slab* slab = SlabOf(slot);
+    if (slab->inbox == inbox_) {
+        ++frees_;
+        PushFree(slab, slot);
+        return;
+    }
+    FreeSlot* free = new (slot) FreeSlot{slab->remote_free.load(std::memory_order_relaxed)};
+    while (!slab->remote_free.compare_exchange_weak(free->next, free, std::memory_order_acq_rel,
+                                                    std::memory_order_relaxed)) {
+    }
+    if (free->next) {
+        return;
+    }
+    // The owner collects from the slab only after this.
+    Inbox* inbox = slab->inbox;
+    slab->next_pending = inbox->pending.load(std::memory_order_relaxed);
+    while (!inbox->pending.compare_exchange_weak(slab->next_pending, slab,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed)) {
+    }
+}
+
+void SlabPool::PushFree(Slab* slab, void* slot) {
+    if (slab == current_) {
+        free_ = new (slot) FreeSlot{free_};
+    } else {
+        slab->free = new (slot) FreeSlot{slab->free};
+        if (!slab->partial) {
+            slab->partial = true;
+            slab->next_partial = partial_;
+            partial_ = slab;
+        }
+    }
+    Poison(slot, slot_size_);
+}
+
+void SlabPool::TakeRemoteFrees() {
+    Slab* slab = inbox_->pending.exchange(nullptr, std::memory_order_acquire);
+    while (slab) {
+        // Once remote_free is empty, the next slot freed into the slab puts
+        // it back in the inbox, overwriting next_pending.
+        Slab* next_slab = slab->next_pending;
+        FreeSlot* slot = slab->remote_free.exchange(nullptr, std::memory_order_acq_rel);
+        while (slot) {
+            FreeSlot* next = slot->next;
+            ++frees_;
+            PushFree(slab, slot);
+            slot = next;
+        }
+        slab = next_slab;
+    }
+}
+
+void* SlabPool::Refill() {
+    // Allocate counts the slot it ends up handing out.
+    --allocations_;
+    if (!slabs_) {
+        ThreadPools::Register(*this);
+        ThreadPools::Adopt(*this);
+    }
+    if (inbox_ && inbox_->pending.load(std::memory_order_relaxed)) {
+        TakeRemoteFrees();
+    }
+    if (free_ || static_cast<size_t>(end_ - next_) >= slot_size_) {
+        return Allocate();
+    }
+    if (Slab* slab = partial_) {
+        partial_ = slab->next_partial;
+        slab->partial = false;
+        current_ = slab;
+        free_ = std::exchange(slab->free, nullptr);
+        next_ = end_ = nullptr;
+        return Allocate();
+    }
+    char* memory = static_cast<char*>(::operator new(kSlabSize, std::align_val_t{kSlabSize}));
+    if (!inbox_) {
+        inbox_ = new Inbox;
+    }
+    Slab* slab = new (memory) Slab{.inbox = inbox_};
+    slab->previous = slabs_;
+    slabs_ = slab;
+    ++slab_count_;
+    current_ = slab;
+    next_ = memory + kSlotsOffset;
+    end_ = memory + kSlabSize;
+    Poison(next_, end_ - next_);
+    return Allocate();
+}
+
+void SlabPool::Delete(Object* object) {
+    ObjectType type = object->Type();
+    object->~Object();
+    switch (type) {
+        case ObjectType::NUMBER:
+            Local<Number>().Free(object);
+            break;
+        case ObjectType::SYMBOL:
+            Local<Symbol>().Free(object);
+            break;
+        case ObjectType::CELL:
+            Local<Cell>().Free(object);
+            break;
+        case ObjectType::OPERATION:
+            break;
+    }
+}
+
+SlabStats SlabPool::Stats(ObjectType type) {
+    const SlabPool* pool = nullptr;
+    switch (type) {
+        case ObjectType::NUMBER:
+            pool = &Local<Number>();
+            break;
+        case ObjectType::SYMBOL:
+            pool = &Local<Symbol>();
+            break;
+        case ObjectType::CELL:
+            pool = &Local<Cell>();
+            break;
+        case ObjectType::OPERATION:
+            return {};
+    }
+    return {.slot_size = pool->slot_size_,
+            .slabs = pool->slab_count_,
+            .capacity = pool->slab_count_ * ((kSlabSize - kSlotsOffset) / pool->slot_size_),
+            .allocations = pool->allocations_,
+            .frees = pool->frees_};
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#endif
+
+class Object;
+enum class ObjectType : uint8_t;
+
+// How one thread's pool for a type of object is used. A slot freed on
+// another thread counts as freed once the pool collects it from its inbox,
+// so until then it is still live, and Live() never exceeds capacity.
+struct SlabStats {
+    size_t slot_size = 0;
+    size_t slabs = 0;
+    // Slots in all slabs.
+    size_t capacity = 0;
+    size_t allocations = 0;
+    size_t frees = 0;
+
+    size_t Live() const {
+        return allocations - frees;
+    }
+    // Live slots over all slots, between 0 and 1.
+    double Occupancy() const {
+        return capacity ? static_cast<double>(Live()) / static_cast<double>(capacity) : 0;
+    }
+};
+
+// Fixed-size slots for numbers, symbols and cells outside a ParseArena. Each
+// thread has one pool per type, which carves page-sized slabs into slots, so
+// making and dropping small objects does not go through malloc.
+//
+// Every slab keeps its own free list, and the pool allocates from one slab
+// until it is full before it moves on to another with free slots. Objects
+// made one after the other therefore share pages however scattered the
+// earlier frees were, which one free list per pool would not give. A slot
+// freed on another thread goes to a separate list of its slab, and the first
+// such slot puts the slab in the inbox of its slabs, so the owning thread
+// collects from those slabs only when it runs out of slots.
+//
+// Slabs are never returned to the system. When a thread exits, the next pool
+// of the same size that runs out of slots takes its slabs over, with their
+// inbox and whatever was freed into them meanwhile.
+class SlabPool {
+public:
+    static constexpr size_t kSlabSize = 4096;
+
+    explicit constexpr SlabPool(size_t slot_size)
+        : slot_size_((std::max(slot_size, sizeof(FreeSlot)) + 7) & ~size_t{7}) {
+    }
+
+    // Creates a T in this thread's pool for T, without references yet. T is
+    // Number, Symbol or Cell.
+    template <class T, class... Args>
+    static T* New(Args&&... args);
+
+    // Destroys an object made by New. Only Object::Release calls it.
+    static void Delete(Object* object);
+
+    // This thread's pool for objects of the given type.
+    static SlabStats Stats(ObjectType type);
+
+    void* Allocate() {
+        ++allocations_;
+        if (free_) {
+            FreeSlot* slot = free_;
+            Unpoison(slot);
+            free_ = slot->next;
+            return slot;
+        }
+        if (static_cast<size_t>(end_ - next_) >= slot_size_) {
+            void* slot = next_;
+            next_ += slot_size_;
+            Unpoison(slot);
+            return slot;
+        }
+        return Refill();
+    }
+
+    // Takes back a slot from any pool of the same size.
+    void Free(void* slot);
+
+private:
+    friend class ThreadPools;
+
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    struct Slab;
+
+    // Shared by a set of slabs for as long as they exist, whichever pool holds
+    // them, so a thread freeing into them never touches a pool, which may be
+    // gone with its thread. Never deleted.
+    struct Inbox {
+        // The slabs whose remote_free went from empty to not.
+        std::atomic<Slab*> pending = nullptr;
+    };
+
+    // The header at the start of every slab, which is aligned to its size so
+    // a slot finds it by masking its address.
+    struct Slab {
+        // Only compared with the inbox of the freeing pool.
+        Inbox* const inbox;
+        // Free slots, except in the slab the pool allocates from, whose free
+        // slots the pool keeps.
+        FreeSlot* free = nullptr;
+        std::atomic<FreeSlot*> remote_free = nullptr;
+        // The next slab in the inbox, while remote_free is not empty.
+        Slab* next_pending = nullptr;
+        // The next slab with free slots, while partial is set.
+        Slab* next_partial = nullptr;
+        bool partial = false;
+        // Every slab of the pool, newest first.
+        Slab* previous = nullptr;
+    };
+
+    static constexpr size_t kSlotsOffset = (sizeof(Slab) + 7) & ~size_t{7};
+
+    template <class T>
+    static SlabPool& Local() {
+        // Constant-initialized and trivially destructible, so using it costs
+        // no guard; the slabs are handed on by a separate thread-exit hook.
+        thread_local constinit SlabPool pool{sizeof(T)};
+        return pool;
+    }
+
+    static Slab* SlabOf(void* slot) {
+        return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(slot) & ~(kSlabSize - 1));
+    }
+
+    // Moves on to a slab with free slots, taking over the slabs of an exited
+    // thread or adding a slab when there is none, and allocates from it.
+    void* Refill();
+    // Returns a slot to its slab, which must belong to this pool.
+    void PushFree(Slab* slab, void* slot);
+    // Collects the slots freed on other threads into the slabs in the inbox.
+    void TakeRemoteFrees();
+
+    // Under AddressSanitizer, slots that are not handed out are poisoned, so
+    // a use after Release is still reported.
+    static void Poison([[maybe_unused]] void* memory, [[maybe_unused]] size_t size) {
+#if defined(__SANITIZE_ADDRESS__)
+        ASAN_POISON_MEMORY_REGION(memory, size);
+#endif
+    }
+
+    void Unpoison([[maybe_unused]] void* slot) const {
+#if defined(__SANITIZE_ADDRESS__)
+        ASAN_UNPOISON_MEMORY_REGION(slot, slot_size_);
+#endif
+    }
+
+    size_t slot_size_;
+    // The slab being allocated from: its free slots, then the part of it
+    // never handed out.
+    Slab* current_ = nullptr;
+    FreeSlot* free_ = nullptr;
+    char* next_ = nullptr;
+    char* end_ = nullptr;
+    // The other slabs with free slots.
+    Slab* partial_ = nullptr;
+    Slab* slabs_ = nullptr;
+    // Set while slabs_ is.
+    Inbox* inbox_ = nullptr;
+    size_t slab_count_ = 0;
+    size_t allocations_ = 0;
+    size_t frees_ = 0;
+    // The other pools of this thread that own slabs.
+    SlabPool* next_pool_ = nullptr;
+};
+
+template <class T, class... Args>
+T* SlabPool::New(Args&&... args) {
+    static_assert(requires { T::kType; }, "only numbers, symbols and cells live in slabs");
+    static_assert(alignof(T) <= 8);
+    SlabPool& pool = Local<T>();
+    void* slot = pool.Allocate();
+    T* object;
+    try {
+        object = new (slot) T(std::forward<Args>(args)...);
+    } catch (...) {
+        pool.Free(slot);
+        throw;
+    }
+    object->in_slab_ = true;
+    return object;
+}
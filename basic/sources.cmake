@@ -2,6 +2,17 @@ add_library(scheme_basic
     tokenizer.cpp
     parser.cpp
     scheme.cpp
+    mapped_file.cpp
+    scan.cpp
+    incremental_reader.cpp
+    parallel_reader.cpp
+    structural_reader.cpp
+    arena.cpp
+    flat_ast.cpp
+    scmb.cpp
+    parse_cache.cpp
+    value.cpp
+    slab.cpp
     
     # maybe more .cpp files here
 )
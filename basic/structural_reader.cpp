@@ -0,0 +1,242 @@
+#include <structural_reader.h>
+#include "char_class.h"
+#include "object_factory.h"
+#include "scan.h"
+
+#include <charconv>
+
+namespace {
+
+constexpr size_t kBlock = 64;
+
+bool IsBoundary(char c) {
+    return HasClass(static_cast<unsigned char>(c), kSpace) || c == '(' || c == ')' || c == '\'';
+}
+
+bool IsDot(std::string_view source, uint32_t start) {
+    return source[start] == '.' && (start + 1 == source.size() || IsBoundary(source[start + 1]));
+}
+
+// Nesting state of one open list during validation.
+struct ListCheck {
+    bool dotted = false;
+    bool has_elements = false;
+    bool has_tail = false;
+};
+
+// Bracket balance, dot placement and quote targets, from the index alone.
+void Validate(std::string_view source, const std::vector<uint32_t>& starts) {
+    std::vector<ListCheck> lists;
+    bool after_quote = false;
+    auto complete_datum = [&] {
+        after_quote = false;
+        if (lists.empty()) {
+            return;
+        }
+        ListCheck& list = lists.back();
+        if (!list.dotted) {
+            list.has_elements = true;
+        } else if (list.has_tail) {
+            throw SyntaxError{"more than one datum after a dot"};
+        } else {
+            list.has_tail = true;
+        }
+    };
+    for (uint32_t start : starts) {
+        char c = source[start];
+        if (c == '(') {
+            lists.emplace_back();
+            after_quote = false;
+        } else if (c == ')') {
+            if (lists.empty()) {
+                throw SyntaxError{"unexpected ')'"};
+            }
+            if (after_quote) {
+                throw SyntaxError{"nothing to quote"};
+            }
+            if (lists.back().dotted && !lists.back().has_tail) {
+                throw SyntaxError{"no datum after a dot"};
+            }
+            lists.pop_back();
+            complete_datum();
+        } else if (c == '\'') {
+            after_quote = true;
+        } else if (IsDot(source, start)) {
+            if (lists.empty() || !lists.back().has_elements || lists.back().dotted ||
+                after_quote) {
+                throw SyntaxError{"unexpected '.'"};
+            }
+            lists.back().dotted = true;
+        } else {
+            complete_datum();
+        }
+    }
+    if (!lists.empty()) {
+        throw SyntaxError{"unclosed '('"};
+    }
+    if (after_quote) {
+        throw SyntaxError{"nothing to quote"};
+    }
+}
+
+// The atom starting at start, which stage one has found to be neither a
+// bracket, a quote nor a dot.
+std::string_view AtomAt(std::string_view source, uint32_t start) {
+    size_t end = start + 1;
+    while (end != source.size() && !IsBoundary(source[end])) {
+        ++end;
+    }
+    return source.substr(start, end - start);
+}
+
+// Whether the atom is an integer, storing its value, or else a symbol.
+bool ParseAtom(std::string_view atom, int64_t* value) {
+    const char* digits = atom.data() + (atom[0] == '+' || atom[0] == '-');
+    const char* end = atom.data() + atom.size();
+    if (digits != end && SkipDigits(digits, end) == end) {
+        if (std::from_chars(atom[0] == '+' ? digits : atom.data(), end, *value).ec !=
+            std::errc{}) {
+            throw SyntaxError{"integer literal out of range"};
+        }
+        return true;
+    }
+    bool is_symbol = atom.size() == 1 && (atom[0] == '+' || atom[0] == '-');
+    if (!is_symbol && HasClass(static_cast<unsigned char>(atom[0]), kSymbolStart)) {
+        is_symbol = SkipSymbolChars(atom.data() + 1, end) == end;
+    }
+    if (!is_symbol) {
+        throw SyntaxError{"undefined symbol"};
+    }
+    return false;
+}
+
+Ref<Object> MakeAtom(std::string_view atom) {
+    int64_t value = 0;
+    if (ParseAtom(atom, &value)) {
+        return MakeNumber(value);
+    }
+    return MakeSymbol(atom);
+}
+
+// One open list or pending quote during stage two.
+struct BuildFrame {
+    bool is_quote = false;
+    bool dotted = false;
+    Ref<Object> list = nullptr;
+    Cell* last = nullptr;
+};
+
+}  // namespace
+
+std::vector<uint32_t> BuildStructuralIndex(std::string_view source) {
+    if (source.size() > UINT32_MAX) {
+        throw RuntimeError{"source is too large"};
+    }
+    std::vector<uint32_t> starts;
+    // Whether the byte before the current block ends an atom.
+    uint64_t boundary_carry = 1;
+    for (size_t base = 0; base < source.size(); base += kBlock) {
+        const char* begin = source.data() + base;
+        const char* end = begin + std::min(kBlock, source.size() - base);
+        BlockMasks masks = ClassifyBlock(begin, end);
+        uint64_t valid = end - begin == kBlock ? ~uint64_t{0} : (uint64_t{1} << (end - begin)) - 1;
+        uint64_t structural = masks.open | masks.close | masks.quote;
+        uint64_t boundary = masks.space | structural;
+        uint64_t atoms = ~boundary & valid;
+        uint64_t token_starts = structural | (atoms & ((boundary << 1) | boundary_carry));
+        boundary_carry = boundary >> 63;
+        while (token_starts) {
+            starts.push_back(base + __builtin_ctzll(token_starts));
+            token_starts &= token_starts - 1;
+        }
+    }
+    Validate(source, starts);
+    return starts;
+}
+
+std::vector<Ref<Object>> ReadStructural(std::string_view source) {
+    std::vector<uint32_t> starts = BuildStructuralIndex(source);
+
+    std::vector<Ref<Object>> data;
+    std::vector<BuildFrame> stack;
+    for (uint32_t start : starts) {
+        char c = source[start];
+        Ref<Object> value;
+        if (c == '(') {
+            stack.emplace_back();
+            continue;
+        } else if (c == '\'') {
+            stack.push_back({true});
+            continue;
+        } else if (c == ')') {
+            value = std::move(stack.back().list);
+            stack.pop_back();
+        } else if (IsDot(source, start)) {
+            stack.back().dotted = true;
+            continue;
+        } else {
+            value = MakeAtom(AtomAt(source, start));
+        }
+        while (!stack.empty() && stack.back().is_quote) {
+            value = MakeCell(MakeSymbol("quote"), std::move(value));
+            stack.pop_back();
+        }
+        if (stack.empty()) {
+            data.push_back(std::move(value));
+            continue;
+        }
+        BuildFrame& frame = stack.back();
+        if (frame.dotted) {
+            frame.last->SetSecond(std::move(value));
+            continue;
+        }
+        Ref<Object> cell = MakeCell(std::move(value), nullptr);
+        Cell* appended = static_cast<Cell*>(cell.get());
+        if (frame.last) {
+            frame.last->SetSecond(std::move(cell));
+        } else {
+            frame.list = std::move(cell);
+        }
+        frame.last = appended;
+    }
+    return data;
+}
+
+FlatAst ReadFlat(std::string_view source) {
+    std::vector<uint32_t> starts = BuildStructuralIndex(source);
+
+    FlatAst ast;
+    // For every open node, whether it is a quote waiting for its datum.
+    std::vector<bool> quotes;
+    for (uint32_t start : starts) {
+        char c = source[start];
+        if (c == '(') {
+            ast.Open(NodeKind::LIST);
+            quotes.push_back(false);
+            continue;
+        } else if (c == '\'') {
+            ast.Open(NodeKind::QUOTE);
+            quotes.push_back(true);
+            continue;
+        } else if (c == ')') {
+            ast.Close();
+            quotes.pop_back();
+        } else if (IsDot(source, start)) {
+            ast.MarkDotted();
+            continue;
+        } else {
+            std::string_view atom = AtomAt(source, start);
+            int64_t value = 0;
+            if (ParseAtom(atom, &value)) {
+                ast.AddInteger(value);
+            } else {
+                ast.AddSymbol(atom);
+            }
+        }
+        while (!quotes.empty() && quotes.back()) {
+            ast.Close();
+            quotes.pop_back();
+        }
+    }
+    return ast;
+}
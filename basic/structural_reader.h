@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "flat_ast.h"
+#include "object.h"
+
+// A second reader engine that works in two passes over a whole buffer.
+//
+// Stage one classifies the source 64 bytes at a time with the vector scanners
+// and records where every token starts. It then checks brackets, dots and
+// quotes on that index alone, so malformed input such as "((1)" or ")(1)" is
+// rejected before any node exists. Stage two walks the index and builds the
+// nodes.
+//
+// Lists come out as proper pairs, and 'x as Cell(quote, x), the same shape
+// Read gives a quote. Atoms are maximal runs of characters other than blanks,
+// brackets and quotes; each must be ".", an integer or a symbol.
+//
+// This is not a replacement for Read. Read joins a nested list to the
+// elements after it instead of making it one element, and the evaluator
+// depends on that shape: "((1) 2)" reads as ((1 . 2)) there and as ((1) 2)
+// here. The two agree on lists without nested lists, dotted pairs and
+// quotes. On its own, on a large data literal, this reader is about 1.1 to
+// 1.3 times as fast as Read, not several times; see bench_reader.
+
+// Stage one. Offsets of every token start, in source order.
+std::vector<uint32_t> BuildStructuralIndex(std::string_view source);
+
+// Both stages: every top-level datum of source, in order.
+std::vector<Ref<Object>> ReadStructural(std::string_view source);
+
+// Both stages, with stage two filling a FlatAst instead of allocating nodes.
+// ToObject on each root gives the same tree as ReadStructural.
+FlatAst ReadFlat(std::string_view source);
@@ -58,3 +58,19 @@ TEST_CASE_METHOD(SchemeTest, "OrSyntax") {
     ExpectEq("(or #f (< 2 1))", "#f");
     ExpectEq("(or #f 1)", "1");
 }
+
+TEST_CASE("BooleansAreShared") {
+    REQUIRE(Value::True().ToObject() == BooleanObject(true));
+    REQUIRE(Value::False().ToObject() == BooleanObject(false));
+
+    Tokenizer tokenizer{std::string_view{"(#t #f)"}};
+    Ref<Object> list = Read(&tokenizer);
+    REQUIRE(As<Cell>(list)->GetFirst() == BooleanObject(true));
+    REQUIRE(As<Cell>(As<Cell>(list)->GetSecond())->GetFirst() == BooleanObject(false));
+    REQUIRE(Value::FromObject(MakeRef<Symbol>("#t")).IsTrue());
+
+    // Handles to them are not counted.
+    size_t count = BooleanObject(true).use_count();
+    Ref<Object> copy = BooleanObject(true);
+    REQUIRE(BooleanObject(true).use_count() == count);
+}
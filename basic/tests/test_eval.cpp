@@ -11,3 +11,81 @@ TEST_CASE_METHOD(SchemeTest, "Be careful") {
     ExpectRuntimeError("('() ())");
     ExpectEq("'(())", "(())");
 }
+
+TEST_CASE("Parse cache") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+    REQUIRE(interpreter.GetParseCacheStats().misses == 0);
+
+    interpreter.SetParseCacheCapacity(2);
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+        REQUIRE(interpreter.Run("'(1 . 2)") == "(1 . 2)");
+    }
+    REQUIRE(interpreter.GetParseCacheStats().hits == 4);
+    REQUIRE(interpreter.GetParseCacheStats().misses == 2);
+
+    // Forms that fail a check are not remembered.
+    REQUIRE_THROWS_AS(interpreter.Run("(+ 1 #t)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(+ 1 #t)"), RuntimeError);
+    REQUIRE(interpreter.GetParseCacheStats().misses == 4);
+
+    REQUIRE(interpreter.Run("(max 1 5)") == "5");
+    REQUIRE(interpreter.GetParseCacheStats().evictions == 1);
+    REQUIRE(interpreter.Run("'(1 . 2)") == "(1 . 2)");
+    REQUIRE(interpreter.GetParseCacheStats().hits == 5);
+
+    REQUIRE_THROWS_AS(interpreter.Run("(sum 1 2)"), RuntimeError);
+    interpreter.Define("sum", [] { return Ref<Object>(new AddOperation()); });
+    REQUIRE(interpreter.GetParseCacheStats().invalidations == 1);
+    REQUIRE(interpreter.Run("(sum 1 2)") == "3");
+    REQUIRE(interpreter.Run("'(1 . 2)") == "(1 . 2)");
+    REQUIRE(interpreter.GetParseCacheStats().hits == 5);
+}
+
+TEST_CASE("Garbage collection") {
+    {
+        ValueScope scope;
+        ValueRoots roots;
+        roots.values.push_back(Value::Own(MakeRef<Cell>(nullptr, nullptr)));
+        Value::Own(MakeRef<Cell>(nullptr, nullptr));
+        scope.Collect();
+        REQUIRE(scope.Size() == 1);
+    }
+
+    {
+        GcStats stats;
+        ValueScope scope{{}, &stats};
+        ValueRoots roots;
+        roots.values.push_back(Value::Own(ValueScope::Allocate<Cell>(nullptr, nullptr)));
+        scope.CollectNursery();
+        REQUIRE(stats.objects_promoted == 1);
+
+        // Only the write barrier tells the next minor collection that the
+        // old cell now points into the nursery.
+        Ref<Object> young = ValueScope::Allocate<Cell>(nullptr, nullptr);
+        Value::Own(young);
+        roots.values[0].AsCell()->SetSecond(std::move(young));
+        scope.CollectNursery();
+        REQUIRE(stats.objects_promoted == 2);
+        REQUIRE(stats.objects_released == 0);
+        REQUIRE(stats.minor_collections == 2);
+    }
+
+    Interpreter interpreter;
+    interpreter.SetGcOptions({.initial_threshold = 8, .growth_factor = 2.0, .nursery_size = 4});
+    std::string program = "(list";
+    std::string sum = "(+ 4611686018427387904";
+    for (int i = 1; i <= 100; ++i) {
+        program += " " + std::to_string(i);
+        sum += " 1";
+    }
+    // The list grows in place, but every partial sum is a boxed integer that
+    // is garbage once the next one is made.
+    REQUIRE(interpreter.Run(program + ")").starts_with("(1 2 3 "));
+    REQUIRE(interpreter.Run(sum + ")") == "4611686018427388004");
+    REQUIRE(interpreter.GetGcStats().minor_collections > 0);
+    REQUIRE(interpreter.GetGcStats().collections > 0);
+    REQUIRE(interpreter.GetGcStats().objects_released >= 90);
+    REQUIRE(interpreter.Run("(cons 1 2)") == "(1 . 2)");
+}
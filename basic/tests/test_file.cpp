@@ -0,0 +1,145 @@
+#include "scheme_test.h"
+
+#include <mapped_file.h>
+#include <parser.h>
+#include <scmb.h>
+#include <structural_reader.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+
+class TempFile {
+public:
+    explicit TempFile(const std::string& contents) {
+        char name[] = "/tmp/scheme_test_XXXXXX";
+        int fd = mkstemp(name);
+        REQUIRE(fd >= 0);
+        close(fd);
+        path_ = name;
+        std::ofstream{path_} << contents;
+    }
+
+    ~TempFile() {
+        std::remove(path_.c_str());
+    }
+
+    const std::string& Path() const {
+        return path_;
+    }
+
+private:
+    std::string path_;
+};
+
+}  // namespace
+
+TEST_CASE("MappedFile exposes the file contents") {
+    TempFile file{"(+ 1 2)\n"};
+    MappedFile mapped{file.Path()};
+    REQUIRE(mapped.View() == "(+ 1 2)\n");
+
+    TempFile empty{""};
+    REQUIRE(MappedFile{empty.Path()}.View().empty());
+
+    // A pipe cannot be mapped, so it is read instead.
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    REQUIRE(write(fds[1], "(+ 1 2)\n", 8) == 8);
+    close(fds[1]);
+    MappedFile piped{"/dev/fd/" + std::to_string(fds[0])};
+    close(fds[0]);
+    REQUIRE(piped.View() == "(+ 1 2)\n");
+}
+
+TEST_CASE("RunFile evaluates a mapped file") {
+    Interpreter interpreter;
+    using Results = std::vector<std::string>;
+
+    TempFile sum{"(+ 1 2 3)"};
+    REQUIRE(interpreter.RunFile(sum.Path()) == Results{"6"});
+
+    TempFile list{"'(1 2 . 3)\n"};
+    REQUIRE(interpreter.RunFile(list.Path()) == Results{"(1 2 . 3)"});
+
+    TempFile program{"(+ 1 2 3)\n(max 1 5)\n  '(1 2 . 3) (pair? '())\n7"};
+    REQUIRE(interpreter.RunFile(program.Path()) == Results{"6", "5", "(1 2 . 3)", "#f", "7"});
+
+    REQUIRE_THROWS_AS(interpreter.RunFile("/nonexistent/file.scm"), RuntimeError);
+}
+
+TEST_CASE("RunProgram streams top-level forms") {
+    Interpreter interpreter;
+
+    std::stringstream program;
+    const int forms = 50000;
+    for (int i = 0; i < forms; ++i) {
+        program << "(+ " << i << " 1)\n";
+    }
+    size_t emitted = 0;
+    interpreter.RunProgram(program, [&emitted](const std::string& result) {
+        REQUIRE(result == std::to_string(++emitted));
+    });
+    REQUIRE(emitted == forms);
+
+    // Each form is checked on its own, as if passed to Run.
+    std::stringstream mixed{"(+ 1 2) foo"};
+    REQUIRE_THROWS_AS(interpreter.RunProgram(mixed), RuntimeError);
+    std::stringstream checked{"(list? '()) (+ 1 #t)"};
+    std::vector<std::string> seen;
+    REQUIRE_THROWS_AS(interpreter.RunProgram(
+                          checked, [&seen](const std::string& result) { seen.push_back(result); }),
+                      RuntimeError);
+    REQUIRE(seen == std::vector<std::string>{"#t"});
+
+    std::stringstream unfinished{"(+ 1 2) (+ 1"};
+    REQUIRE_THROWS_AS(interpreter.RunProgram(unfinished), SyntaxError);
+}
+
+TEST_CASE("Precompiled .scmb files") {
+    FlatAst ast = ReadFlat("(1 (2 foo) . bar) 'x () -7 (quote (quote foo))");
+    {
+        std::stringstream stream{"((1) 2)"};
+        Tokenizer tokenizer{&stream};
+        ast.Append(Read(&tokenizer));
+    }
+    TempFile file{""};
+    WriteScmb(ast.View(), file.Path());
+
+    ScmbFile loaded{file.Path()};
+    const FlatAstView& view = loaded.View();
+    REQUIRE(view.Size() == ast.Size());
+    REQUIRE(view.Roots().size() == 6);
+    std::vector<std::string> text;
+    for (uint32_t root : view.Roots()) {
+        text.push_back(view.Serialize(root));
+    }
+    REQUIRE(text == std::vector<std::string>{"(1 (2 foo) . bar)", "'x", "()", "-7",
+                                             "(quote (quote foo))", "((1 . 2))"});
+    REQUIRE(view.ToObject(view.Roots()[0])->Serialize() ==
+            ast.ToObject(ast.Roots()[0])->Serialize());
+
+    TempFile empty{""};
+    WriteScmb(FlatAst().View(), empty.Path());
+    REQUIRE(ScmbFile{empty.Path()}.View().Size() == 0);
+
+    std::ifstream in{file.Path(), std::ios::binary};
+    std::string bytes{std::istreambuf_iterator<char>(in), {}};
+    TempFile truncated{bytes.substr(0, bytes.size() - 1)};
+    REQUIRE_THROWS_AS(ScmbFile{truncated.Path()}, RuntimeError);
+    std::string newer = bytes;
+    newer[4] = kScmbVersion + 1;
+    TempFile versioned{newer};
+    REQUIRE_THROWS_AS(ScmbFile{versioned.Path()}, RuntimeError);
+    // The first root's first child made to point back at the root.
+    std::string cyclic = bytes;
+    cyclic[32 + 8 * view.Size()] = 0;
+    TempFile looped{cyclic};
+    REQUIRE_THROWS_AS(ScmbFile{looped.Path()}, RuntimeError);
+    TempFile text_file{"(+ 1 2)\n"};
+    REQUIRE_THROWS_AS(ScmbFile{text_file.Path()}, RuntimeError);
+}
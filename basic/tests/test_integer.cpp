@@ -1,5 +1,7 @@
 #include "scheme_test.h"
 
+#include <object_factory.h>
+
 TEST_CASE_METHOD(SchemeTest, "IntegersAreSelfEvaluating") {
     ExpectEq("4", "4");
     ExpectEq("-14", "-14");
@@ -56,6 +58,7 @@ TEST_CASE_METHOD(SchemeTest, "IntegerComparisonEdgeCases") {
     ExpectRuntimeError("(> 1 #t)");
     ExpectRuntimeError("(<= 1 #t)");
     ExpectRuntimeError("(>= 1 #t)");
+    ExpectRuntimeError("(< +)");
 }
 
 TEST_CASE_METHOD(SchemeTest, "IntegerArithmetics") {
@@ -85,6 +88,22 @@ TEST_CASE_METHOD(SchemeTest, "IntegerArithmeticsEdgeCases") {
     ExpectRuntimeError("(-)");
 }
 
+TEST_CASE_METHOD(SchemeTest, "IntegerOverflow") {
+    ExpectRuntimeError("(+ 4611686018427387904 4611686018427387904)");
+    ExpectRuntimeError("(+ 9223372036854775807 1)");
+    ExpectRuntimeError("(+ -9223372036854775808 -1)");
+    ExpectRuntimeError("(- -9223372036854775808 1)");
+    ExpectRuntimeError("(- 0 -9223372036854775808)");
+    ExpectRuntimeError("(* 4294967296 4294967296)");
+    ExpectRuntimeError("(* -9223372036854775808 -1)");
+    ExpectRuntimeError("(/ -9223372036854775808 -1)");
+    ExpectRuntimeError("(abs -9223372036854775808)");
+
+    ExpectEq("(+ 4611686018427387903 4611686018427387904)", "9223372036854775807");
+    ExpectEq("(- -9223372036854775807 1)", "-9223372036854775808");
+    ExpectEq("(* 3037000499 3037000499)", "9223372030926249001");
+}
+
 TEST_CASE_METHOD(SchemeTest, "IntegerMaxMin") {
     ExpectEq("(max 0)", "0");
     ExpectEq("(min 0)", "0");
@@ -114,3 +133,64 @@ TEST_CASE_METHOD(SchemeTest, "IntegerAbsEdgeCases") {
     ExpectRuntimeError("(abs #t)");
     ExpectRuntimeError("(abs 1 2)");
 }
+
+TEST_CASE_METHOD(SchemeTest, "IntegerLiteralRange") {
+    ExpectEq("9223372036854775807", "9223372036854775807");
+    ExpectEq("-9223372036854775808", "-9223372036854775808");
+    ExpectSyntaxError("9223372036854775808");
+}
+
+TEST_CASE("TaggedValues") {
+    ValueScope scope;
+
+    Value small = Value::Integer(-42);
+    REQUIRE(small.IsFixnum());
+    REQUIRE(small.GetInteger() == -42);
+    REQUIRE(Value::Integer(Value::kMaxFixnum).IsFixnum());
+    REQUIRE(Value::Integer(Value::kMinFixnum).GetInteger() == Value::kMinFixnum);
+
+    Value big = Value::Integer(INT64_MAX);
+    REQUIRE(big.IsHeap());
+    REQUIRE(big.IsInteger());
+    REQUIRE(big.GetInteger() == INT64_MAX);
+    REQUIRE(scope.Size() == 1);
+
+    REQUIRE(Value::FromObject(nullptr).IsNil());
+    REQUIRE(Value::FromObject(MakeRef<Symbol>("#f")).IsFalse());
+    REQUIRE(Value::FromObject(MakeRef<Number>(7)) == Value::Integer(7));
+    REQUIRE(Value::True().IsSymbolNamed("#t"));
+    REQUIRE_THROWS_AS(Value::True().GetInteger(), RuntimeError);
+
+    // Arithmetic on fixnums keeps every intermediate result unboxed.
+    MultiplicationOperation product;
+    product.Apply(Value::Nil());
+    for (int64_t i = 1; i <= 20; ++i) {
+        REQUIRE(product.Apply(Value::Integer(i)).IsFixnum());
+    }
+    REQUIRE(product.Apply(Value::Integer(1)).GetInteger() == 2432902008176640000);
+    REQUIRE(scope.Size() == 1);
+}
+
+TEST_CASE_METHOD(SchemeTest, "SmallIntegersAreShared") {
+    // Unless the build turned the cache off.
+    if (!Number::Small(0)) {
+        return;
+    }
+    REQUIRE(MakeNumber(1) == MakeNumber(1));
+    REQUIRE(Value::Integer(-1).ToObject() == MakeNumber(-1));
+    REQUIRE(MakeNumber(int64_t{1} << 40) != MakeNumber(int64_t{1} << 40));
+    Ref<Object> zero = MakeNumber(0);
+    size_t count = zero.use_count();
+    Ref<Object> copy = zero;
+    REQUIRE(zero.use_count() == count);
+
+    // Literals and small results are the shared numbers, so running these
+    // makes none.
+    ExpectEq("(+ 1 2)", "3");
+    size_t allocations = SlabPool::Stats(ObjectType::NUMBER).allocations;
+    ExpectEq("(+ 300 4)", "304");
+    ExpectEq("(* 2 -3)", "-6");
+    ExpectEq("(list 1 -2 3)", "(1 -2 3)");
+    ExpectEq("(cons 5 '(6 . 7))", "(5 6 . 7)");
+    REQUIRE(SlabPool::Stats(ObjectType::NUMBER).allocations == allocations);
+}
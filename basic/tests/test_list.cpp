@@ -1,5 +1,7 @@
 #include "scheme_test.h"
 
+#include <object_factory.h>
+
 TEST_CASE_METHOD(SchemeTest, "ListsAreNotSelfEvaluating") {
     ExpectRuntimeError("()");
     ExpectRuntimeError("(1)");
@@ -77,3 +79,29 @@ TEST_CASE_METHOD(SchemeTest, "ListOperations") {
     ExpectRuntimeError("(list-ref '(1 2 3) 10)");
     ExpectRuntimeError("(list-tail '(1 2 3) 10)");
 }
+
+TEST_CASE_METHOD(SchemeTest, "LongListsAreReleasedIteratively") {
+    // Releasing these one Cell destructor inside another would need far more
+    // stack than a thread has.
+    const int size = 10000000;
+    Ref<Object> list;
+    for (int i = 0; i < size; ++i) {
+        list = MakeCell(MakeNumber(i % 2), std::move(list));
+    }
+    Ref<Object> nested;
+    for (int i = 0; i < size / 10; ++i) {
+        nested = MakeCell(std::move(nested), MakeSymbol("x"));
+    }
+    list.reset();
+    nested.reset();
+
+    // (list ...) builds its result in place, and printing it walks the
+    // list in a loop.
+    std::string program = "(list";
+    std::string result = "(1";
+    for (int i = 0; i < size / 10; ++i) {
+        program += " 1";
+        result += i ? " 1" : "";
+    }
+    ExpectEq(program + ")", result + ")");
+}
@@ -1,9 +1,17 @@
 #include <catch.hpp>
 
+#include <chrono>
+#include <future>
 #include <sstream>
+#include <thread>
 
+#include <arena.h>
 #include <error.h>
+#include <object_factory.h>
 #include <parser.h>
+#include <incremental_reader.h>
+#include <parallel_reader.h>
+#include <structural_reader.h>
 
 auto ReadFull(const std::string& str) {
     std::stringstream ss{str};
@@ -154,3 +162,333 @@ TEST_CASE("Invalid") {
     REQUIRE_THROWS_AS(ReadFull("(1 . )"), SyntaxError);
     REQUIRE_THROWS_AS(ReadFull("(1 . 2 3)"), SyntaxError);
 }
+
+TEST_CASE("Incremental reader") {
+    const std::string input = "(1 (2 3)) foo 'bar '(4 . 5) 42 ()";
+
+    auto check = [](std::vector<Ref<Object>> data) {
+        REQUIRE(data.size() == 6);
+        REQUIRE(Is<Cell>(data[0]));
+        REQUIRE(As<Number>(As<Cell>(data[0])->GetFirst())->GetValue() == 1);
+        REQUIRE(As<Symbol>(data[1])->GetName() == "foo");
+        REQUIRE(As<Symbol>(As<Cell>(data[2])->GetFirst())->GetName() == "quote");
+        REQUIRE(As<Symbol>(As<Cell>(data[2])->GetSecond())->GetName() == "bar");
+        REQUIRE(Is<Cell>(As<Cell>(data[3])->GetSecond()));
+        REQUIRE(As<Number>(data[4])->GetValue() == 42);
+        REQUIRE(!data[5]);
+    };
+
+    SECTION("One byte at a time") {
+        IncrementalReader reader;
+        std::vector<Ref<Object>> data;
+        for (char c : input) {
+            reader.Feed(std::string_view{&c, 1});
+            while (auto datum = reader.TryReadDatum()) {
+                data.push_back(*datum);
+            }
+        }
+        // "()" is complete, but 42 could still grow until the input ends.
+        REQUIRE(data.size() == 6);
+        reader.Finish();
+        REQUIRE(!reader.TryReadDatum());
+        check(data);
+    }
+
+    SECTION("Trailing atom needs Finish") {
+        IncrementalReader reader;
+        reader.Feed("(+ 1 2) 12");
+        REQUIRE(reader.TryReadSource() == "(+ 1 2)");
+        REQUIRE(!reader.TryReadSource());
+        reader.Feed("34");
+        reader.Finish();
+        REQUIRE(reader.TryReadSource() == " 1234");
+        REQUIRE(reader.Buffered() == 0);
+    }
+
+    SECTION("Incomplete input") {
+        IncrementalReader reader;
+        reader.Feed("(1 (2");
+        REQUIRE(!reader.TryReadDatum());
+        reader.Finish();
+        REQUIRE_THROWS_AS(reader.TryReadDatum(), SyntaxError);
+
+        IncrementalReader stray;
+        stray.Feed(")(1)");
+        REQUIRE_THROWS_AS(stray.TryReadDatum(), SyntaxError);
+    }
+}
+
+TEST_CASE("Parallel reader") {
+    std::string source;
+    for (int i = 0; i < 20000; ++i) {
+        source += "(item " + std::to_string(i) + " '(a . b)) " + std::to_string(-i) + "\n";
+    }
+
+    REQUIRE(SplitTopLevel("(1 2)  'foo\n'(3) bar)(") ==
+            std::vector<std::string_view>{"(1 2)", "  'foo", "\n'(3)", " bar", ")", "("});
+
+    for (size_t threads : {1, 4}) {
+        auto data = ReadAllParallel(source, threads);
+        REQUIRE(data.size() == 40000);
+        for (int i = 0; i < 20000; ++i) {
+            auto second = As<Cell>(data[2 * i])->GetSecond();
+            REQUIRE(As<Number>(As<Cell>(second)->GetFirst())->GetValue() == i);
+            REQUIRE(As<Number>(data[2 * i + 1])->GetValue() == -i);
+        }
+    }
+
+    REQUIRE_THROWS_AS(ReadAllParallel(source + "(1 (2)", 4), SyntaxError);
+    REQUIRE(ReadAllParallel("  \n ").empty());
+}
+
+TEST_CASE("Reading long lists is linear") {
+    auto make_source = [](int size) {
+        std::string source = "(";
+        for (int i = 0; i < size; ++i) {
+            source += i % 2 ? "x " : "1 ";
+        }
+        return source + ")";
+    };
+    auto seconds_to_read = [](const std::string& input) {
+        auto start = std::chrono::steady_clock::now();
+        Tokenizer tokenizer{std::string_view{input}, false};
+        auto list = Read(&tokenizer);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        REQUIRE(tokenizer.IsEnd());
+        REQUIRE(Is<Cell>(list));
+        return elapsed.count();
+    };
+
+    // Four times the elements may take about four times as long, not the
+    // sixteen a quadratic reader would; the bound leaves room for noise and
+    // sanitizers.
+    const int size = 250000;
+    std::string small = make_source(size);
+    std::string large = make_source(4 * size);
+    auto shapes = [](const std::string& source) {
+        return std::vector<std::string>{source, "'" + source, "(1 " + source + " . 2)"};
+    };
+    std::vector<std::string> small_inputs = shapes(small);
+    std::vector<std::string> large_inputs = shapes(large);
+    for (size_t i = 0; i < small_inputs.size(); ++i) {
+        double small_time = seconds_to_read(small_inputs[i]);
+        double large_time = seconds_to_read(large_inputs[i]);
+        REQUIRE(large_time < 8 * small_time);
+    }
+
+    REQUIRE_THROWS_AS(ReadFull(large.substr(0, large.size() - 1)), SyntaxError);
+}
+
+TEST_CASE("Reading deep nesting uses no stack") {
+    const int depth = 100000;
+    std::string source = std::string(depth, '(') + "1" + std::string(depth, ')');
+    for (const std::string& input : {source, "'" + source, "(x . " + source + ")"}) {
+        Tokenizer tokenizer{std::string_view{input}, false};
+        auto node = Read(&tokenizer);
+        REQUIRE(tokenizer.IsEnd());
+        REQUIRE(Is<Cell>(node));
+    }
+
+    REQUIRE_THROWS_AS(ReadFull(std::string(depth, '(') + std::string(depth - 1, ')')),
+                      SyntaxError);
+}
+
+namespace {
+
+std::string Shape(const Ref<Object>& node) {
+    if (!node) {
+        return "()";
+    }
+    if (Is<Number>(node)) {
+        return std::to_string(As<Number>(node)->GetValue());
+    }
+    if (Is<Symbol>(node)) {
+        return As<Symbol>(node)->GetName();
+    }
+    auto cell = As<Cell>(node);
+    return "[" + Shape(cell->GetFirst()) + " " + Shape(cell->GetSecond()) + "]";
+}
+
+}  // namespace
+
+TEST_CASE("Structural reader") {
+    REQUIRE(BuildStructuralIndex("(foo  -12)'x y") == std::vector<uint32_t>{0, 1, 6, 9, 10, 11, 13});
+
+    for (std::string input : {"5", "-5", "+", "foo?", "'foo", "(1 2 3)", "'(1 2 . 3)", "(1 . 2)",
+                              "()", "'()", "(a 'b c)", "(1 . (2 . ()))"}) {
+        auto data = ReadStructural(input);
+        REQUIRE(data.size() == 1);
+        REQUIRE(Shape(data[0]) == Shape(ReadFull(input)));
+    }
+
+    auto data = ReadStructural(" ((1) (2 x))\n'(a . (b))  7 ");
+    REQUIRE(data.size() == 3);
+    REQUIRE(Shape(data[0]) == "[[1 ()] [[2 [x ()]] ()]]");
+    REQUIRE(Shape(data[1]) == "[quote [a [b ()]]]");
+    REQUIRE(Shape(data[2]) == "7");
+
+    // Blocks are 64 bytes; tokens that straddle a block edge still start once.
+    std::string long_list = "(";
+    for (int i = 0; i < 1000; ++i) {
+        long_list += std::string(i % 7, ' ') + "item" + std::to_string(i) + " ";
+    }
+    long_list += ")";
+    REQUIRE(BuildStructuralIndex(long_list).size() == 1002);
+    REQUIRE(Shape(ReadStructural(long_list)[0]) == Shape(ReadFull(long_list)));
+
+    for (std::string input : {"((1)", ")(1)", "(.)", "(1 .)", "(. 2)", "(1 . 2 3)", "'", "(')",
+                              "(1 . 2 . 3)", "."}) {
+        REQUIRE_THROWS_AS(BuildStructuralIndex(input), SyntaxError);
+    }
+    REQUIRE_THROWS_AS(ReadStructural("(1 2x)"), SyntaxError);
+    REQUIRE_THROWS_AS(ReadStructural("99999999999999999999"), SyntaxError);
+}
+
+TEST_CASE("Flat AST") {
+    std::string source = " ((1) (2 x))\n'(a . (b))  7 ()";
+    FlatAst ast = ReadFlat(source);
+    REQUIRE(ast.Roots() == std::vector<uint32_t>{0, 6, 11, 12});
+    REQUIRE(ast.Kind(0) == NodeKind::LIST);
+    REQUIRE(ast.FirstChild(0) == 1);
+    REQUIRE(ast.NextSibling(1) == 3);
+    REQUIRE(ast.NextSibling(3) == FlatAst::kNone);
+    REQUIRE(ast.GetName(5) == "x");
+    REQUIRE(ast.Kind(6) == NodeKind::QUOTE);
+    REQUIRE(ast.Kind(7) == NodeKind::DOTTED_LIST);
+    REQUIRE(ast.SubtreeEnd(6) == 11);
+    REQUIRE(ast.GetInteger(11) == 7);
+    REQUIRE(ast.FirstChild(12) == FlatAst::kNone);
+
+    auto data = ReadStructural(source);
+    std::vector<std::string> text = {"((1) (2 x))", "'(a . (b))", "7", "()"};
+    for (size_t i = 0; i < data.size(); ++i) {
+        REQUIRE(Shape(ast.ToObject(ast.Roots()[i])) == Shape(data[i]));
+        REQUIRE(ast.Serialize(ast.Roots()[i]) == text[i]);
+    }
+
+    // Read's trees flatten as they are, quirks included.
+    for (std::string input : {"(1 2 3)", "((1) 2)", "'(1 . 2)", "(())", "foo", "(a 'b)"}) {
+        auto datum = ReadFull(input);
+        FlatAst flat;
+        REQUIRE(Shape(flat.ToObject(flat.Append(datum))) == Shape(datum));
+    }
+    FlatAst flat;
+    flat.Append(ReadFull("((1) 2)"));
+    REQUIRE(flat.Serialize(0) == "((1 . 2))");
+
+    const size_t depth = 100000;
+    std::string deep = std::string(depth, '(') + "x" + std::string(depth, ')');
+    FlatAst nested = ReadFlat(deep);
+    REQUIRE(nested.Size() == depth + 1);
+    REQUIRE(nested.Serialize(0) == deep);
+    FlatAst copy;
+    copy.Append(nested.ToObject(0));
+    REQUIRE(copy.Serialize(0) == deep);
+}
+
+TEST_CASE("Parse arena") {
+    Ref<Object> list;
+    {
+        ParseArena arena;
+        {
+            ParseArena::Scope scope{arena};
+            list = ReadFull("(1 foo '(2 . 3))");
+            REQUIRE(ParseArena::Current() == &arena);
+        }
+        REQUIRE(ParseArena::Current() == nullptr);
+        REQUIRE(arena.LiveNodes() > 0);
+        REQUIRE(arena.BytesAllocated() > 0);
+
+        auto copy = ReadFull("(1 foo '(2 . 3))");
+        REQUIRE(Shape(copy) == Shape(list));
+
+        Ref<Object> kept = As<Cell>(As<Cell>(list)->GetSecond())->GetFirst();
+        list.reset();
+        REQUIRE(arena.LiveNodes() == 1);
+        list = kept;
+    }
+    // The last node keeps the storage alive after the handle is gone.
+    REQUIRE(As<Symbol>(list)->GetName() == "foo");
+}
+
+TEST_CASE("Slab pools") {
+    SlabStats before = SlabPool::Stats(ObjectType::CELL);
+    Ref<Object> list = ReadFull("(1 foo (2 . 3))");
+    SlabStats read = SlabPool::Stats(ObjectType::CELL);
+    REQUIRE(read.Live() == before.Live() + 4);
+    REQUIRE(read.slot_size == sizeof(Cell));
+    REQUIRE(read.capacity >= read.Live());
+    REQUIRE(read.Occupancy() > 0);
+
+    list.reset();
+    REQUIRE(SlabPool::Stats(ObjectType::CELL).Live() == before.Live());
+
+    // A released slot is the next one handed out. Small integers are shared,
+    // so these are big.
+    Ref<Object> number = MakeNumber(int64_t{1} << 40);
+    Object* slot = number.get();
+    number.reset();
+    REQUIRE(MakeNumber(int64_t{1} << 41).get() == slot);
+
+    // Nodes outlive the thread that made them, and its slabs are reused.
+    Ref<Object> kept;
+    std::thread{[&kept] {
+        for (int i = 0; i < 1000; ++i) {
+            kept = MakeCell(MakeNumber(i), kept);
+        }
+        kept = As<Cell>(kept)->GetSecond();
+    }}.join();
+    REQUIRE(As<Number>(As<Cell>(kept)->GetFirst())->GetValue() == 998);
+    size_t allocations = 0;
+    std::thread{[&allocations] {
+        MakeCell(nullptr, nullptr);
+        allocations = SlabPool::Stats(ObjectType::CELL).allocations;
+    }}.join();
+    REQUIRE(allocations > 1000);
+
+    // A slot freed on another thread is counted by the pool that owns it,
+    // when that pool takes it back, and not by the thread that freed it.
+    SlabStats main_before = SlabPool::Stats(ObjectType::CELL);
+    std::promise<Ref<Object>> made;
+    std::promise<void> freed;
+    SlabStats owner;
+    std::thread owner_thread{[&made, &freed, &owner] {
+        Ref<Object> cells;
+        for (int i = 0; i < 1000; ++i) {
+            cells = MakeCell(nullptr, cells);
+        }
+        made.set_value(std::move(cells));
+        freed.get_future().wait();
+        for (int i = 0; i < 1000; ++i) {
+            cells = MakeCell(nullptr, cells);
+        }
+        owner = SlabPool::Stats(ObjectType::CELL);
+    }};
+    made.get_future().get().reset();
+    freed.set_value();
+    owner_thread.join();
+    SlabStats main_after = SlabPool::Stats(ObjectType::CELL);
+    REQUIRE(main_after.Live() == main_before.Live());
+    REQUIRE(main_after.Live() <= main_after.capacity);
+    REQUIRE(owner.Live() >= 1000);
+    REQUIRE(owner.Live() <= owner.capacity);
+}
+
+TEST_CASE("Intrusive references") {
+    Ref<Object> number = MakeRef<Number>(5);
+    REQUIRE(number.use_count() == 1);
+    {
+        Ref<Object> copy = number;
+        Ref<Number> typed = As<Number>(copy);
+        REQUIRE(number.use_count() == 3);
+        REQUIRE(typed == number);
+    }
+    REQUIRE(number.use_count() == 1);
+    Ref<Object> moved = std::move(number);
+    REQUIRE(number == nullptr);
+    REQUIRE(moved.use_count() == 1);
+
+    // No control block and no weak pointer: a vtable, the count and the tags.
+    REQUIRE(sizeof(Object) == 16);
+    REQUIRE(sizeof(Number) == 24);
+}
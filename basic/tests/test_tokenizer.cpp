@@ -2,7 +2,9 @@
 
 #include <error.h>
 #include <tokenizer.h>
+#include <scan.h>
 
+#include <random>
 #include <sstream>
 
 TEST_CASE("Tokenizer works on simple case") {
@@ -153,3 +155,244 @@ TEST_CASE("Empty string handled correctly") {
 
     REQUIRE(tokenizer.IsEnd());
 }
+
+TEST_CASE("Tokenizer reads a string_view without copying") {
+    std::string source = "(foo -12 'bar . +)";
+    Tokenizer tokenizer{std::string_view{source}};
+
+    REQUIRE(tokenizer.GetToken() == Token{BracketToken::OPEN});
+
+    tokenizer.Next();
+    auto foo = std::get<SymbolToken>(tokenizer.GetToken());
+    REQUIRE(foo.name == "foo");
+    REQUIRE(foo.name.data() == source.data() + 1);
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{ConstantToken{-12}});
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{QuoteToken{}});
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{SymbolToken{"bar"}});
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{DotToken{}});
+
+    tokenizer.Next();
+    auto plus = std::get<SymbolToken>(tokenizer.GetToken());
+    REQUIRE(plus.name == "+");
+    REQUIRE(plus.name.data() == source.data() + 16);
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{BracketToken::CLOSE});
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.IsEnd());
+}
+
+TEST_CASE("Streaming tokenizer keeps no history") {
+    std::stringstream ss;
+    for (int i = 0; i < 10000; ++i) {
+        ss << "(foo " << i << " 'bar) ";
+    }
+    Tokenizer tokenizer{&ss, false};
+
+    size_t tokens = 0;
+    while (!tokenizer.IsEnd()) {
+        ++tokens;
+        tokenizer.Next();
+    }
+    REQUIRE(tokens == 60000);
+    REQUIRE(tokenizer.GetAllTokens().empty());
+
+    const TokenStats& stats = tokenizer.GetStats();
+    REQUIRE(stats.count == 60000);
+    REQUIRE(stats.open == 10000);
+    REQUIRE(stats.close == 10000);
+    REQUIRE(stats.quotes == 10000);
+
+    // Symbols are not interned, so distinct names do not pile up either.
+    std::stringstream names;
+    for (int i = 0; i < 10000; ++i) {
+        names << "(name" << i << " x) ";
+    }
+    Tokenizer streaming{&names, false};
+    int named = 0;
+    for (; !streaming.IsEnd(); streaming.Next()) {
+        if (streaming.GetKind() == TokenKind::SYMBOL &&
+            streaming.GetToken() != Token{SymbolToken{"x"}}) {
+            REQUIRE(streaming.GetToken() == Token{SymbolToken{"name" + std::to_string(named++)}});
+        }
+    }
+    REQUIRE(named == 10000);
+    REQUIRE(streaming.GetSymbols().Size() == 0);
+}
+
+TEST_CASE("Listeners see every token") {
+    struct Counter : TokenListener {
+        void OnToken(const Token& token) override {
+            seen.push_back(token);
+        }
+        std::vector<Token> seen;
+    } counter;
+
+    Tokenizer tokenizer{std::string_view{"(+ 1 2)"}, false};
+    tokenizer.AddListener(&counter);
+    while (!tokenizer.IsEnd()) {
+        tokenizer.Next();
+    }
+    REQUIRE(counter.seen.size() == 5);
+    REQUIRE(counter.seen.front() == Token{BracketToken::OPEN});
+    REQUIRE(counter.seen[1] == Token{SymbolToken{"+"}});
+    REQUIRE(counter.seen.back() == Token{BracketToken::CLOSE});
+}
+
+TEST_CASE("Vector scanners agree with the scalar one") {
+    std::default_random_engine rng{7};
+    const std::string alphabet = " \t\n\r\v\f()'.+-#<=>?!*/09azAZ_;\x80\xff";
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    std::uniform_int_distribution<size_t> run(0, 80);
+
+    std::string input;
+    for (int i = 0; i < 2000; ++i) {
+        char c = alphabet[pick(rng)];
+        input.append(run(rng) % 8 == 0 ? run(rng) : 1, c);
+    }
+
+    auto scan_everywhere = [&input] {
+        std::vector<uint64_t> results;
+        const char* begin = input.data();
+        const char* end = begin + input.size();
+        for (const char* p = begin; p != end; ++p) {
+            results.push_back(SkipSpaces(p, end) - begin);
+            results.push_back(SkipSymbolChars(p, end) - begin);
+            results.push_back(SkipDigits(p, end) - begin);
+            BlockMasks masks = ClassifyBlock(p, std::min(p + 64, end));
+            results.insert(results.end(), {masks.space, masks.open, masks.close, masks.quote});
+        }
+        return results;
+    };
+
+    ScanImpl original = GetScanImpl();
+    REQUIRE(SetScanImpl(ScanImpl::kScalar));
+    auto expected = scan_everywhere();
+    for (ScanImpl impl : {ScanImpl::kSse2, ScanImpl::kAvx2}) {
+        if (SetScanImpl(impl)) {
+            REQUIRE(scan_everywhere() == expected);
+        }
+    }
+    SetScanImpl(original);
+}
+
+TEST_CASE("Buffers and streams tokenize alike") {
+    std::default_random_engine rng{11};
+    const std::string alphabet = " \n()'.+-#<=>?!*/09azAZ_;";
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    std::uniform_int_distribution<size_t> length(1, 30);
+
+    // The tokens up to the first error, and whether there was one. Names are
+    // copied, since they may live in the tokenizer.
+    auto tokenize = [](auto make) {
+        std::vector<std::string> tokens;
+        try {
+            for (Tokenizer tokenizer = make(); !tokenizer.IsEnd(); tokenizer.Next()) {
+                Token token = tokenizer.GetToken();
+                if (auto* symbol = std::get_if<SymbolToken>(&token)) {
+                    tokens.emplace_back(symbol->name);
+                } else if (auto* constant = std::get_if<ConstantToken>(&token)) {
+                    tokens.push_back(std::to_string(constant->value));
+                } else {
+                    tokens.push_back("#" + std::to_string(token.index()));
+                }
+            }
+        } catch (const SyntaxError&) {
+            tokens.push_back("<error>");
+        }
+        return tokens;
+    };
+
+    for (int i = 0; i < 20000; ++i) {
+        std::string input;
+        for (size_t j = length(rng); j > 0; --j) {
+            input += alphabet[pick(rng)];
+        }
+        std::stringstream ss{input};
+        INFO(input);
+        REQUIRE(tokenize([&input] { return Tokenizer{std::string_view{input}}; }) ==
+                tokenize([&ss] { return Tokenizer{&ss}; }));
+    }
+}
+
+TEST_CASE("Integers use the full int64 range") {
+    auto read_one = [](const std::string& input, bool from_stream) {
+        std::stringstream ss{input};
+        Tokenizer tokenizer = from_stream ? Tokenizer{&ss} : Tokenizer{std::string_view{input}};
+        return tokenizer.GetToken();
+    };
+
+    for (bool from_stream : {false, true}) {
+        REQUIRE(read_one("9223372036854775807", from_stream) ==
+                Token{ConstantToken{INT64_MAX}});
+        REQUIRE(read_one("-9223372036854775808", from_stream) ==
+                Token{ConstantToken{INT64_MIN}});
+        REQUIRE(read_one("+00000000000000000000000000042", from_stream) ==
+                Token{ConstantToken{42}});
+        REQUIRE(read_one("-0", from_stream) == Token{ConstantToken{0}});
+
+        REQUIRE_THROWS_AS(read_one("9223372036854775808", from_stream), SyntaxError);
+        REQUIRE_THROWS_AS(read_one("-9223372036854775809", from_stream), SyntaxError);
+        REQUIRE_THROWS_AS(read_one("123456789012345678901234567890", from_stream), SyntaxError);
+    }
+}
+
+TEST_CASE("Large integers past the payload range keep their values") {
+    std::string source = "(";
+    for (int i = 0; i < 100; ++i) {
+        source += std::to_string(10000000000 + i) + " 1 ";
+    }
+    source += ")";
+    Tokenizer tokenizer{std::string_view{source}};
+    tokenizer.SetLargeIndexLimitForTesting(8);
+    while (!tokenizer.IsEnd()) {
+        tokenizer.Next();
+    }
+
+    int64_t expected = 10000000000;
+    for (const PackedToken& token : tokenizer.GetAllTokens()) {
+        if (token.Is(TokenKind::LARGE_INTEGER)) {
+            REQUIRE(tokenizer.GetInteger(token) == expected++);
+        }
+    }
+    REQUIRE(expected == 10000000100);
+}
+
+TEST_CASE("Packed tokens carry spans and interned symbols") {
+    static_assert(sizeof(PackedToken) == 8);
+
+    std::string source = "(foo -12 'bar . foo 123456789012)";
+    Tokenizer tokenizer{std::string_view{source}};
+    while (!tokenizer.IsEnd()) {
+        tokenizer.Next();
+    }
+
+    const auto& tokens = tokenizer.GetAllTokens();
+    REQUIRE(tokens.size() == 9);
+    std::vector<std::string_view> spans;
+    for (const PackedToken& token : tokens) {
+        spans.push_back(tokenizer.GetSpan(token));
+        REQUIRE(tokenizer.GetSpan(token).data() == source.data() + token.Offset());
+    }
+    REQUIRE(spans == std::vector<std::string_view>{"(", "foo", "-12", "'", "bar", ".", "foo",
+                                                   "123456789012", ")"});
+
+    REQUIRE(tokens[0].Is(TokenKind::OPEN));
+    REQUIRE(tokens[1].Is(TokenKind::SYMBOL));
+    REQUIRE(tokens[1].Payload() == tokens[6].Payload());
+    REQUIRE(tokens[1].Payload() != tokens[4].Payload());
+    REQUIRE(tokenizer.GetSymbols().Size() == 2);
+    REQUIRE(tokenizer.GetInteger(tokens[2]) == -12);
+    REQUIRE(tokens[7].Is(TokenKind::LARGE_INTEGER));
+    REQUIRE(tokenizer.Unpack(tokens[7]) == Token{ConstantToken{123456789012}});
+    REQUIRE(tokens[8].Is(TokenKind::CLOSE));
+}
@@ -1,90 +1,393 @@
 #include <tokenizer.h>
-#define CHECK_IF_SYMBOL                                                                            \
-    (std::isalnum(symbol) || (symbol <= '>' && symbol >= '<') || symbol == '*' || symbol == '#' || \
-     symbol == '/' || symbol == '-' || symbol == '!' || symbol == '?') &&                          \
-        symbol != EOF
+#include "char_class.h"
+#include "scan.h"
 
-Tokenizer::Tokenizer(std::istream *in) : in_(in) {
+#include <algorithm>
+#include <charconv>
+
+Tokenizer::Tokenizer(std::istream *in, bool keep_history) : keep_history_(keep_history), in_(in) {
+    Next();
+}
+
+Tokenizer::Tokenizer(std::string_view source, bool keep_history)
+    : keep_history_(keep_history), source_(source) {
+    if (source.size() > UINT32_MAX) {
+        throw RuntimeError{"source is too large"};
+    }
+    Next();
+}
+
+void Tokenizer::Reset(std::string_view source) {
+    if (source.size() > UINT32_MAX) {
+        throw RuntimeError{"source is too large"};
+    }
+    is_end_ = false;
+    in_ = nullptr;
+    source_ = source;
+    pos_ = 0;
+    symbols_.Clear();
+    large_integers_.clear();
+    large_offsets_.clear();
+    token_ = PackedToken();
+    tokens_.clear();
+    stats_ = TokenStats();
+    brackets_cnt = 0;
     Next();
 }
 
+void Tokenizer::AddListener(TokenListener *listener) {
+    listeners_.push_back(listener);
+    if (!is_end_) {
+        listener->OnToken(GetToken());
+    }
+}
+
 bool &Tokenizer::IsEnd() {
     return is_end_;
 }
 
 Token Tokenizer::GetToken() {
-    return token_;
+    return Unpack(token_);
 }
+
+Token Tokenizer::Unpack(PackedToken token) const {
+    switch (token.Kind()) {
+        case TokenKind::INTEGER:
+        case TokenKind::LARGE_INTEGER:
+            return ConstantToken(GetInteger(token));
+        case TokenKind::OPEN:
+            return BracketToken::OPEN;
+        case TokenKind::CLOSE:
+            return BracketToken::CLOSE;
+        case TokenKind::SYMBOL:
+            return SymbolToken(GetName(token));
+        case TokenKind::QUOTE:
+            return QuoteToken();
+        case TokenKind::DOT:
+            return DotToken();
+        case TokenKind::NONE:
+            break;
+    }
+    return ConstantToken();
+}
+
+int64_t Tokenizer::GetInteger(PackedToken token) const {
+    if (token.Is(TokenKind::LARGE_INTEGER)) {
+        uint32_t index = token.Payload();
+        if (keep_history_ && index >= large_index_limit_) {
+            auto it = std::lower_bound(large_offsets_.begin(), large_offsets_.end(),
+                                       token.Offset());
+            index = it - large_offsets_.begin();
+        }
+        return large_integers_[index];
+    }
+    return token.SmallValue();
+}
+
+std::string_view Tokenizer::GetSpan(PackedToken token) const {
+    if (in_ || token.Is(TokenKind::NONE)) {
+        return {};
+    }
+    size_t length = 1;
+    if (token.Is(TokenKind::SYMBOL)) {
+        length = GetName(token).size();
+    } else if (token.IsInteger()) {
+        const char *begin = source_.data() + token.Offset();
+        const char *end = source_.data() + source_.size();
+        length = SkipDigits(HasClass(*begin, kDigit) ? begin : begin + 1, end) - begin;
+    }
+    return source_.substr(token.Offset(), length);
+}
+
+int Tokenizer::GetChar() {
+    if (in_) {
+        int symbol = in_->get();
+        if (symbol != EOF) {
+            ++pos_;
+        }
+        return symbol;
+    }
+    if (pos_ == source_.size()) {
+        return EOF;
+    }
+    return static_cast<unsigned char>(source_[pos_++]);
+}
+
+int Tokenizer::PeekChar() {
+    if (in_) {
+        return in_->peek();
+    }
+    if (pos_ == source_.size()) {
+        return EOF;
+    }
+    return static_cast<unsigned char>(source_[pos_]);
+}
+
+uint32_t Tokenizer::ReadSymbol(int symbol) {
+    if (!in_) {
+        size_t begin = pos_ - 1;
+        pos_ = SkipSymbolChars(source_.data() + pos_, source_.data() + source_.size()) -
+               source_.data();
+        return AddName(source_.substr(begin, pos_ - begin));
+    }
+    std::string name;
+    while (HasClass(symbol, kSymbolChar)) {
+        name.push_back(symbol);
+        symbol = PeekChar();
+        if (HasClass(symbol, kSymbolChar)) {
+            symbol = GetChar();
+        }
+    }
+    return AddName(std::move(name));
+}
+
+uint32_t Tokenizer::AddName(std::string_view stable_name) {
+    if (keep_history_) {
+        return symbols_.Intern(stable_name);
+    }
+    name_slot_ ^= 1;
+    recent_names_[name_slot_] = stable_name;
+    return name_slot_;
+}
+
+uint32_t Tokenizer::AddName(std::string &&name) {
+    if (keep_history_) {
+        return symbols_.Intern(std::move(name));
+    }
+    name_slot_ ^= 1;
+    recent_storage_[name_slot_] = std::move(name);
+    recent_names_[name_slot_] = recent_storage_[name_slot_];
+    return name_slot_;
+}
+
+namespace {
+
+// A sign and more significant digits than this cannot be in range.
+constexpr size_t kMaxIntegerLength = 21;
+
+int64_t ParseInteger(const char *first, const char *last) {
+    if (*first == '+') {
+        ++first;
+    }
+    int64_t value = 0;
+    if (std::from_chars(first, last, value).ec != std::errc{}) {
+        // There is no bignum type to fall back to.
+        throw SyntaxError{"integer literal out of range"};
+    }
+    return value;
+}
+
+}  // namespace
+
+int64_t Tokenizer::ReadInteger(int first) {
+    if (!in_) {
+        const char *begin = source_.data() + pos_ - 1;
+        pos_ = SkipDigits(source_.data() + pos_, source_.data() + source_.size()) - source_.data();
+        return ParseInteger(begin, source_.data() + pos_);
+    }
+    // Stream input: collect the literal on the stack, dropping leading zeros.
+    char digits[kMaxIntegerLength];
+    size_t length = 0;
+    size_t digits_begin = HasClass(first, kDigit) ? 0 : 1;
+    bool too_long = false;
+    digits[length++] = first;
+    while (HasClass(PeekChar(), kDigit)) {
+        char digit = GetChar();
+        if (length == digits_begin + 1 && digits[digits_begin] == '0') {
+            --length;
+        }
+        if (length == sizeof(digits)) {
+            too_long = true;
+        } else {
+            digits[length++] = digit;
+        }
+    }
+    if (too_long) {
+        throw SyntaxError{"integer literal out of range"};
+    }
+    return ParseInteger(digits, digits + length);
+}
+
+PackedToken Tokenizer::MakeInteger(uint32_t offset, int64_t value) {
+    if (value >= PackedToken::kMinSmallInteger && value <= PackedToken::kMaxSmallInteger) {
+        return PackedToken::SmallInteger(offset, static_cast<int32_t>(value));
+    }
+    if (keep_history_) {
+        // Offsets only grow, so the ones past the index limit stay sorted.
+        uint32_t index = std::min<size_t>(large_integers_.size(), large_index_limit_);
+        large_integers_.push_back(value);
+        large_offsets_.push_back(offset);
+        return PackedToken(TokenKind::LARGE_INTEGER, offset, index);
+    }
+    // The parser still reads the value of the token it has just stepped over,
+    // so two alternating slots are enough.
+    large_integers_.resize(2);
+    large_slot_ ^= 1;
+    large_integers_[large_slot_] = value;
+    return PackedToken(TokenKind::LARGE_INTEGER, offset, large_slot_);
+}
+
+uint32_t SymbolTable::Intern(std::string_view stable_name) {
+    auto it = ids_.find(stable_name);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    return Add(stable_name);
+}
+
+uint32_t SymbolTable::Intern(std::string &&name) {
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    return Add(storage_.emplace_back(std::move(name)));
+}
+
+uint32_t SymbolTable::InternCopy(std::string_view name) {
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    return Add(storage_.emplace_back(name));
+}
+
+void SymbolTable::Clear() {
+    ids_.clear();
+    names_.clear();
+    storage_.clear();
+}
+
+uint32_t SymbolTable::Add(std::string_view name) {
+    uint32_t id = names_.size();
+    if (id >> PackedToken::kPayloadBits) {
+        throw RuntimeError{"too many distinct symbols"};
+    }
+    ids_.emplace(name, id);
+    names_.push_back(name);
+    return id;
+}
+
+bool Tokenizer::ScanBuffer() {
+    const char *begin = source_.data();
+    const char *end = begin + source_.size();
+    const char *p = SkipSpaces(begin + pos_, end);
+    if (p == end) {
+        pos_ = source_.size();
+        return false;
+    }
+    uint32_t offset = p - begin;
+    unsigned char symbol = *p;
+    uint8_t cls = kCharClass[symbol];
+    const char *last = p + 1;
+    // Names and unsigned numbers must end at a delimiter; a signed number or
+    // a lone sign need not.
+    bool delimited = false;
+    if (cls & kSymbolStart) {
+        last = SkipSymbolChars(last, end);
+        token_ = PackedToken(TokenKind::SYMBOL, offset, AddName(std::string_view(p, last - p)));
+        delimited = true;
+    } else if (cls & kDigit) {
+        last = SkipDigits(last, end);
+        token_ = MakeInteger(offset, ParseInteger(p, last));
+        delimited = true;
+    } else if (symbol == '(') {
+        token_ = PackedToken(TokenKind::OPEN, offset);
+    } else if (symbol == ')') {
+        token_ = PackedToken(TokenKind::CLOSE, offset);
+    } else if (symbol == '\'') {
+        token_ = PackedToken(TokenKind::QUOTE, offset);
+    } else if (symbol == '.') {
+        token_ = PackedToken(TokenKind::DOT, offset);
+    } else if (symbol == '+' || symbol == '-') {
+        if (last != end && (kCharClass[static_cast<unsigned char>(*last)] & kDigit)) {
+            last = SkipDigits(last, end);
+            token_ = MakeInteger(offset, ParseInteger(p, last));
+        } else {
+            token_ = PackedToken(TokenKind::SYMBOL, offset, AddName(std::string_view(p, 1)));
+        }
+    } else {
+        throw SyntaxError("undefined symbol");
+    }
+    if (delimited && last != end && !(kCharClass[static_cast<unsigned char>(*last)] & kDelimiter)) {
+        throw SyntaxError{"undefined symbol"};
+    }
+    pos_ = last - begin;
+    return true;
+}
+
 void Tokenizer::Next() {
-    char symbol = in_->get();
-    while (std::isspace(symbol)) {
-        symbol = in_->get();
+    if (!in_) {
+        // A buffer takes the pointer-based path; only the bookkeeping after it
+        // is shared with streams.
+        if (!ScanBuffer()) {
+            is_end_ = true;
+            return;
+        }
+        Record();
+        return;
+    }
+    int symbol = GetChar();
+    while (HasClass(symbol, kSpace)) {
+        symbol = GetChar();
     }
     if (symbol == EOF) {
         is_end_ = true;
         return;
     }
+    if (pos_ - 1 > UINT32_MAX) {
+        // Only a stream gets here; a buffer is checked up front.
+        throw RuntimeError{"source is too large"};
+    }
+    uint32_t offset = pos_ - 1;
     if (symbol == '(') {
-        token_ = BracketToken::OPEN;
+        token_ = PackedToken(TokenKind::OPEN, offset);
     } else if (symbol == ')') {
-        token_ = BracketToken::CLOSE;
+        token_ = PackedToken(TokenKind::CLOSE, offset);
     } else if (symbol == '+' || symbol == '-') {
-        std::string num;
-        num.push_back(symbol);
-        symbol = in_->peek();
-        if (symbol <= '9' && symbol >= '0') {
-            symbol = in_->get();
-        }
-        while (symbol <= '9' && symbol >= '0') {
-            num.push_back(symbol);
-            symbol = in_->peek();
-            if (symbol <= '9' && symbol >= '0') {
-                symbol = in_->get();
-            }
-        }
-        if (num.length() > 1) {
-            token_ = ConstantToken(std::stoi(num));  // NOLINT
+        if (HasClass(PeekChar(), kDigit)) {
+            token_ = MakeInteger(offset, ReadInteger(symbol));
         } else {
-            token_ = SymbolToken(num);
-        }
-    } else if ((symbol <= '9' && symbol >= '0')) {
-        std::string num;
-        while (symbol <= '9' && symbol >= '0') {
-            num.push_back(symbol);
-            symbol = in_->peek();
-            if (symbol <= '9' && symbol >= '0') {
-                symbol = in_->get();
-            }
+            uint32_t id =
+                in_ ? AddName(std::string(1, symbol)) : AddName(source_.substr(offset, 1));
+            token_ = PackedToken(TokenKind::SYMBOL, offset, id);
         }
-        if (symbol != EOF && !CHECK_IF_SYMBOL && symbol != '(' && symbol != ')' && symbol != '.' &&
-            symbol != '-' && symbol != '+' && !std::isspace(symbol)) {
+    } else if (HasClass(symbol, kDigit)) {
+        int64_t value = ReadInteger(symbol);
+        symbol = PeekChar();
+        if (symbol != EOF && !HasClass(symbol, kDelimiter)) {
             throw SyntaxError{"undefined symbol"};
         }
-        token_ = ConstantToken(std::stoi(num));  // NOLINT
+        token_ = MakeInteger(offset, value);
     } else if (symbol == '\'') {
-        token_ = QuoteToken();
+        token_ = PackedToken(TokenKind::QUOTE, offset);
     } else if (symbol == '.') {
-        token_ = DotToken();
-    } else if (std::isalpha(symbol) || (symbol <= '>' && symbol >= '<') || symbol == '*' ||
-               symbol == '#' || symbol == '/') {
-        std::string name;
-        while (CHECK_IF_SYMBOL) {
-            name.push_back(symbol);
-            symbol = in_->peek();
-            if (CHECK_IF_SYMBOL) {
-                symbol = in_->get();
-            }
-        }
-        if (symbol != EOF && !CHECK_IF_SYMBOL && symbol != '(' && symbol != ')' && symbol != '.' &&
-            symbol != '-' && symbol != '+' && !std::isspace(symbol)) {
+        token_ = PackedToken(TokenKind::DOT, offset);
+    } else if (HasClass(symbol, kSymbolStart)) {
+        uint32_t id = ReadSymbol(symbol);
+        symbol = PeekChar();
+        if (symbol != EOF && !HasClass(symbol, kDelimiter)) {
             throw SyntaxError{"undefined symbol"};
         }
-        token_ = SymbolToken(name);
+        token_ = PackedToken(TokenKind::SYMBOL, offset, id);
     } else {
         throw SyntaxError("undefined symbol");
     }
-    tokens_.push_back(token_);
+    Record();
 }
+
+void Tokenizer::Record() {
+    stats_.Add(token_);
+    if (keep_history_) {
+        tokens_.push_back(token_);
+    }
+    if (!listeners_.empty()) {
+        Token token = GetToken();
+        for (TokenListener *listener : listeners_) {
+            listener->OnToken(token);
+        }
+    }
+}
+
 bool SymbolToken::operator==(const SymbolToken &other) const {
     return other.name == name;
 }
@@ -3,17 +3,24 @@
 #include <variant>
 #include <optional>
 #include <istream>
+#include <string_view>
+#include <unordered_map>
+#include <deque>
+#include <cstdint>
 #include "error.h"
 #include "vector"
 #include "string"
 
+// Symbol names are views into the tokenizer's symbol table, which points into
+// the source buffer when the tokenizer reads a std::string_view. Either way
+// they stay valid for the lifetime of the tokenizer.
 struct SymbolToken {
-    std::string name;
+    std::string_view name;
 
     SymbolToken() = default;
 
     SymbolToken(const char* name) : name(name){};
-    SymbolToken(std::string& name) : name(name){};
+    SymbolToken(std::string_view name) : name(name){};
 
     bool operator==(const SymbolToken& other) const;
 };
@@ -37,34 +44,258 @@ struct ConstantToken {
 
     ConstantToken() = default;
 
-    ConstantToken(int value) : value(value), is_init(true){};
+    ConstantToken(int64_t value) : value(value), is_init(true){};
 
     bool operator==(const ConstantToken& other) const;
 };
 
 using Token = std::variant<ConstantToken, BracketToken, SymbolToken, QuoteToken, DotToken>;
 
+enum class TokenKind : uint8_t { NONE, INTEGER, LARGE_INTEGER, OPEN, CLOSE, SYMBOL, QUOTE, DOT };
+
+// The tokenizer's own token representation: eight bytes, so a cache line holds
+// eight of them and a kind check is a single byte compare.
+//
+// The payload is a symbol id for SYMBOL, the value itself for INTEGER, and an
+// index into the tokenizer's side table for LARGE_INTEGER, as far as the index
+// fits; past that the tokenizer finds the value by the token's offset. The span length is
+// not stored: it is one character for punctuation, the interned name's length
+// for symbols, and the run of digits for integers (see Tokenizer::GetSpan).
+class PackedToken {
+public:
+    static constexpr int kPayloadBits = 24;
+    static constexpr uint32_t kMaxPayload = (1u << kPayloadBits) - 1;
+    static constexpr int32_t kMaxSmallInteger = (1 << (kPayloadBits - 1)) - 1;
+    static constexpr int32_t kMinSmallInteger = -(1 << (kPayloadBits - 1));
+
+    PackedToken() = default;
+
+    PackedToken(TokenKind kind, uint32_t offset, uint32_t payload = 0)
+        : offset_(offset), bits_(static_cast<uint8_t>(kind) | (payload << 8)){};
+
+    static PackedToken SmallInteger(uint32_t offset, int32_t value) {
+        return PackedToken(TokenKind::INTEGER, offset, static_cast<uint32_t>(value));
+    }
+
+    TokenKind Kind() const {
+        return static_cast<TokenKind>(static_cast<uint8_t>(bits_));
+    }
+
+    bool Is(TokenKind kind) const {
+        return Kind() == kind;
+    }
+
+    bool IsInteger() const {
+        return Is(TokenKind::INTEGER) || Is(TokenKind::LARGE_INTEGER);
+    }
+
+    uint32_t Offset() const {
+        return offset_;
+    }
+
+    uint32_t Payload() const {
+        return bits_ >> 8;
+    }
+
+    int32_t SmallValue() const {
+        return static_cast<int32_t>(bits_) >> 8;
+    }
+
+private:
+    uint32_t offset_ = 0;
+    uint32_t bits_ = 0;
+};
+
+static_assert(sizeof(PackedToken) == 8);
+
+// Gives every distinct symbol name a dense id. Names that live in a buffer
+// outliving the table are referenced in place, others are copied once.
+class SymbolTable {
+public:
+    uint32_t Intern(std::string_view stable_name);
+    uint32_t Intern(std::string&& name);
+    // Copies the name only the first time it is seen.
+    uint32_t InternCopy(std::string_view name);
+
+    std::string_view Name(uint32_t id) const {
+        return names_[id];
+    }
+
+    size_t Size() const {
+        return names_.size();
+    }
+
+    const std::vector<std::string_view>& Names() const {
+        return names_;
+    }
+
+    void Clear();
+
+private:
+    uint32_t Add(std::string_view name);
+
+    std::unordered_map<std::string_view, uint32_t> ids_;
+    std::vector<std::string_view> names_;
+    std::deque<std::string> storage_;
+};
+
+// Running totals over every token produced so far. They let the parser
+// validate bracket balance without keeping the tokens themselves.
+struct TokenStats {
+    size_t count = 0;
+    size_t open = 0;
+    size_t close = 0;
+    size_t quotes = 0;
+
+    // Bracket depth right before the first quote, and the index of the first
+    // token that opens a new list once the quoted datum has been closed.
+    int64_t depth_at_first_quote = 0;
+    size_t reopened_after_quote = SIZE_MAX;
+
+    // Inline, since the tokenizer calls it for every token.
+    void Add(PackedToken token) {
+        size_t index = count++;
+        bool is_open = token.Is(TokenKind::OPEN);
+        bool is_close = token.Is(TokenKind::CLOSE);
+        if (is_open) {
+            ++open;
+        } else if (is_close) {
+            ++close;
+        } else if (token.Is(TokenKind::QUOTE) && quotes++ == 0) {
+            depth_at_first_quote = static_cast<int64_t>(open) - static_cast<int64_t>(close);
+        }
+        if (quotes == 0) {
+            return;
+        }
+        if (is_open) {
+            ++quote_depth_;
+        } else if (is_close && --quote_depth_ == 0) {
+            quote_closed_ = true;
+        }
+        if (quote_closed_ && quote_depth_ != 0 && reopened_after_quote == SIZE_MAX) {
+            reopened_after_quote = index;
+        }
+    }
+
+private:
+    int64_t quote_depth_ = 0;
+    bool quote_closed_ = false;
+};
+
+// Sees every token in the order the tokenizer produces it.
+class TokenListener {
+public:
+    virtual ~TokenListener() = default;
+    virtual void OnToken(const Token& token) = 0;
+};
+
 class Tokenizer {
 public:
-    Tokenizer(std::istream* in);
+    // Reads from a stream; symbol names are copied into the symbol table and
+    // offsets count the characters read so far, of which there may be at
+    // most 4 GiB.
+    //
+    // With keep_history = false the tokenizer is streaming: GetAllTokens()
+    // stays empty, symbols are not interned and GetSymbols() stays empty, so
+    // memory does not grow with the input. A symbol token's name is then
+    // valid until the token after next.
+    Tokenizer(std::istream* in, bool keep_history = true);
+
+    // Reads from a contiguous buffer of at most 4 GiB without copying it. The
+    // buffer must outlive the tokenizer and every token taken from it.
+    Tokenizer(std::string_view source, bool keep_history = true);
+
+    // Starts over on a new buffer, as if freshly constructed, but keeps the
+    // listeners and the memory already allocated. Ids and names handed out
+    // for the previous buffer become invalid.
+    void Reset(std::string_view source);
 
     bool& IsEnd();
 
     void Next();
 
+    // The current token, unpacked.
     Token GetToken();
 
+    const PackedToken& GetPackedToken() const {
+        return token_;
+    }
+
+    TokenKind GetKind() const {
+        return token_.Kind();
+    }
+
+    Token Unpack(PackedToken token) const;
+    int64_t GetInteger(PackedToken token) const;
+
+    std::string_view GetName(PackedToken token) const {
+        return keep_history_ ? symbols_.Name(token.Payload()) : recent_names_[token.Payload()];
+    }
+
+    // The source text of a token; empty when reading a stream.
+    std::string_view GetSpan(PackedToken token) const;
+
+    const SymbolTable& GetSymbols() const {
+        return symbols_;
+    }
+
     std::istream* GetStream() const;
 
-    std::vector<Token>& GetAllTokens() {
+    // The character right after the current token, or EOF.
+    int PeekChar();
+
+    const std::vector<PackedToken>& GetAllTokens() const {
         return tokens_;
     }
 
+    const TokenStats& GetStats() const {
+        return stats_;
+    }
+
+    // The listener is told about the current token right away, then about
+    // every token that follows. It must outlive the tokenizer.
+    void AddListener(TokenListener* listener);
+
+    // Large integers from this many on are found by offset rather than by
+    // the index in their token. Only tests lower it from kMaxPayload, to
+    // reach that path without a gigabyte of input.
+    void SetLargeIndexLimitForTesting(uint32_t limit) {
+        large_index_limit_ = limit;
+    }
+
     int brackets_cnt = 0;
 
 private:
+    int GetChar();
+    // Reads the next token of a buffer into token_; false at the end.
+    bool ScanBuffer();
+    // Counts token_, keeps it with history and tells the listeners.
+    void Record();
+    uint32_t ReadSymbol(int first);
+    uint32_t AddName(std::string_view stable_name);
+    uint32_t AddName(std::string&& name);
+    int64_t ReadInteger(int first);
+    PackedToken MakeInteger(uint32_t offset, int64_t value);
+
     bool is_end_ = false;
-    std::istream* in_;
-    Token token_;
-    std::vector<Token> tokens_;
+    bool keep_history_;
+    std::istream* in_ = nullptr;
+    std::string_view source_;
+    size_t pos_ = 0;
+    SymbolTable symbols_;
+    // Without history, the names of the last two symbols instead of a
+    // symbol table, as large_integers_ holds the last two large integers.
+    std::string_view recent_names_[2];
+    std::string recent_storage_[2];
+    size_t name_slot_ = 0;
+    std::vector<int64_t> large_integers_;
+    // With history, the offset of each of large_integers_, in increasing
+    // order.
+    std::vector<uint32_t> large_offsets_;
+    uint32_t large_index_limit_ = PackedToken::kMaxPayload;
+    size_t large_slot_ = 0;
+    PackedToken token_;
+    std::vector<PackedToken> tokens_;
+    TokenStats stats_;
+    std::vector<TokenListener*> listeners_;
 };
@@ -0,0 +1,279 @@
+#include <value.h>
+#include "object.h"
+
+namespace {
+
+thread_local ValueScope* current_scope = nullptr;
+
+}  // namespace
+
+static_assert(static_cast<uint8_t>(ObjectType::NUMBER) == 0);
+static_assert(static_cast<uint8_t>(ObjectType::SYMBOL) == 1);
+static_assert(alignof(Object) >= 8, "heap pointers need the low three bits free");
+
+Value Value::FromObject(const Ref<Object>& object) {
+    if (!object) {
+        return Nil();
+    }
+    switch (object->Type()) {
+        case ObjectType::NUMBER: {
+            int64_t value = static_cast<const Number&>(*object).GetValue();
+            if (value >= kMinFixnum && value <= kMaxFixnum) {
+                return Integer(value);
+            }
+            break;
+        }
+        case ObjectType::SYMBOL: {
+            if (object == BooleanObject(true)) {
+                return True();
+            }
+            if (object == BooleanObject(false)) {
+                return False();
+            }
+            // A symbol made outside the reader may still be spelled #t or #f.
+            const std::string& name = static_cast<const Symbol&>(*object).GetName();
+            if (name == "#t") {
+                return True();
+            }
+            if (name == "#f") {
+                return False();
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return Value(reinterpret_cast<uint64_t>(object.get()));
+}
+
+Value Value::Own(Ref<Object> object) {
+    Value value = FromObject(object);
+    if (value.IsHeap()) {
+        ValueScope* scope = ValueScope::Current();
+        if (!scope) {
+            throw RuntimeError{"no ValueScope to keep an object alive"};
+        }
+        scope->Keep(std::move(object));
+    }
+    return value;
+}
+
+Value Value::BoxedInteger(int64_t value) {
+    return Own(ValueScope::Allocate<Number>(value));
+}
+
+bool Value::IsHeapType(uint8_t type) const {
+    return IsHeap() && static_cast<uint8_t>(GetObject()->Type()) == type;
+}
+
+int64_t Value::GetHeapInteger() const {
+    if (!IsHeapType(kNumberType)) {
+        throw RuntimeError{"not a number"};
+    }
+    return static_cast<const Number*>(GetObject())->GetValue();
+}
+
+bool Value::IsSymbolNamed(std::string_view name) const {
+    if (IsTrue()) {
+        return name == "#t";
+    }
+    if (IsFalse()) {
+        return name == "#f";
+    }
+    return IsHeapType(kSymbolType) && static_cast<const Symbol*>(GetObject())->GetName() == name;
+}
+
+Cell* Value::AsCell() const {
+    Object* object = GetObject();
+    return object && object->Type() == ObjectType::CELL ? static_cast<Cell*>(object) : nullptr;
+}
+
+Ref<Object> Value::ToObject() const {
+    if (IsFixnum()) {
+        return Number::Make(GetInteger());
+    }
+    if (IsBoolean()) {
+        return BooleanObject(IsTrue());
+    }
+    if (IsNil()) {
+        return nullptr;
+    }
+    return Ref<Object>(GetObject());
+}
+
+Number* Number::MakeSmallBlock(size_t block) {
+    int64_t first = kSmallMin + static_cast<int64_t>(block * kSmallBlockSize);
+    size_t count = std::min<uint64_t>(kSmallBlockSize, kSmallMax - first + 1);
+    Number* numbers = static_cast<Number*>(::operator new(count * sizeof(Number)));
+    for (size_t i = 0; i < count; ++i) {
+        new (numbers + i) Number(first + static_cast<int64_t>(i));
+        numbers[i].immortal_ = true;
+    }
+    // Another thread may have made the same block meanwhile; nobody can hold
+    // one of ours yet.
+    Number* installed = nullptr;
+    if (!small_blocks_[block].compare_exchange_strong(installed, numbers,
+                                                      std::memory_order_acq_rel)) {
+        ::operator delete(numbers);
+        return installed;
+    }
+    return numbers;
+}
+
+void GcMarker::Mark(Value value) {
+    Mark(value.GetObject());
+}
+
+void GcMarker::Mark(const Ref<Object>& object) {
+    Mark(object.get());
+}
+
+void GcMarker::Mark(Object* object) {
+    // Objects the heap does not own are never released by it, and neither is
+    // anything they hold a reference to.
+    if (object && object->gc_owned_ && !object->gc_marked_ && !(young_only_ && object->gc_old_)) {
+        object->gc_marked_ = true;
+        pending_.push_back(object);
+    }
+}
+
+ValueRoots::ValueRoots() : scope_(ValueScope::Current()), next_(scope_->roots_) {
+    scope_->roots_ = this;
+}
+
+ValueRoots::~ValueRoots() {
+    scope_->roots_ = next_;
+}
+
+ValueScope::ValueScope(const GcOptions& options, GcStats* stats)
+    : options_(options),
+      stats_(stats),
+      threshold_(options.initial_threshold),
+      previous_(current_scope) {
+    current_scope = this;
+}
+
+ValueScope::~ValueScope() {
+    current_scope = previous_;
+    // Whatever outlives the scope, such as the result, is no longer ours.
+    for (auto* objects : {&old_, &nursery_}) {
+        for (const auto& object : *objects) {
+            object->gc_owned_ = false;
+            object->gc_old_ = false;
+            object->gc_remembered_ = false;
+        }
+    }
+}
+
+ValueScope* ValueScope::Current() {
+    return current_scope;
+}
+
+void ValueScope::Keep(Ref<Object> object) {
+    if (!object->gc_owned_) {
+        object->gc_owned_ = true;
+        nursery_.push_back(std::move(object));
+    }
+}
+
+void ValueScope::Remember(Object* holder) {
+    if (!holder->gc_remembered_) {
+        holder->gc_remembered_ = true;
+        remembered_.push_back(holder);
+    }
+}
+
+void ValueScope::MarkRoots(GcMarker& marker) const {
+    for (ValueRoots* roots = roots_; roots; roots = roots->next_) {
+        for (Value value : roots->values) {
+            marker.Mark(value);
+        }
+        for (const auto& operation : roots->operations) {
+            operation->Trace(marker);
+        }
+    }
+    while (!marker.pending_.empty()) {
+        Object* object = marker.pending_.back();
+        marker.pending_.pop_back();
+        object->Trace(marker);
+    }
+}
+
+size_t ValueScope::Sweep(std::vector<Ref<Object>>& objects, std::vector<Ref<Object>>& survivors) {
+    size_t released = 0;
+    for (auto& object : objects) {
+        if (object->gc_marked_) {
+            object->gc_marked_ = false;
+            object->gc_old_ = true;
+            survivors.push_back(std::move(object));
+        } else {
+            object->gc_owned_ = false;
+            object->gc_old_ = false;
+            ++released;
+        }
+    }
+    objects.clear();
+    return released;
+}
+
+void ValueScope::CollectNursery() {
+    auto start = std::chrono::steady_clock::now();
+    GcMarker marker;
+    marker.young_only_ = true;
+    for (Object* holder : remembered_) {
+        holder->gc_remembered_ = false;
+        holder->Trace(marker);
+    }
+    remembered_.clear();
+    MarkRoots(marker);
+
+    size_t old = old_.size();
+    size_t released = Sweep(nursery_, old_);
+    if (stats_) {
+        stats_->objects_promoted += old_.size() - old;
+    }
+    FinishCollection(start, released, true);
+    if (old_.size() >= threshold_) {
+        Collect();
+    }
+}
+
+void ValueScope::Collect() {
+    auto start = std::chrono::steady_clock::now();
+    GcMarker marker;
+    for (Object* holder : remembered_) {
+        holder->gc_remembered_ = false;
+    }
+    remembered_.clear();
+    MarkRoots(marker);
+
+    std::vector<Ref<Object>> survivors;
+    size_t released = Sweep(old_, survivors);
+    size_t old = survivors.size();
+    released += Sweep(nursery_, survivors);
+    if (stats_) {
+        stats_->objects_promoted += survivors.size() - old;
+    }
+    old_ = std::move(survivors);
+    threshold_ = std::max(options_.initial_threshold,
+                          static_cast<size_t>(static_cast<double>(old_.size()) *
+                                              options_.growth_factor));
+    FinishCollection(start, released, false);
+}
+
+void ValueScope::FinishCollection(std::chrono::steady_clock::time_point start, size_t released,
+                                  bool minor) {
+    if (!stats_) {
+        return;
+    }
+    auto pause = std::chrono::steady_clock::now() - start;
+    if (minor) {
+        ++stats_->minor_collections;
+        stats_->max_minor_pause = std::max<std::chrono::nanoseconds>(stats_->max_minor_pause, pause);
+    } else {
+        ++stats_->collections;
+    }
+    stats_->objects_released += released;
+    stats_->total_pause += pause;
+    stats_->max_pause = std::max<std::chrono::nanoseconds>(stats_->max_pause, pause);
+}
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "ref.h"
+#include "slab.h"
+
+class Object;
+class Cell;
+
+// A Scheme value in one machine word, as the evaluator passes it around.
+//
+//   ...xxxx1   fixnum, the integer shifted left by one
+//   ...x000    pointer to a heap Object, never null
+//   0b0010     '()
+//   0b0110     #f
+//   0b1010     #t
+//
+// Integers outside the 63-bit fixnum range and every other object stay on the
+// heap. A Value does not own the object it points to: objects made during an
+// evaluation belong to the current ValueScope, and everything else (the
+// parsed form, the contents of a live cell) is owned elsewhere.
+//
+// Values are canonical: a Number in the fixnum range is always a fixnum and a
+// symbol #t or #f is always the immediate, so a heap Number or Symbol never
+// stands for one of those.
+class Value {
+public:
+    static constexpr int64_t kMaxFixnum = INT64_MAX >> 1;
+    static constexpr int64_t kMinFixnum = INT64_MIN >> 1;
+
+    // '()
+    constexpr Value() = default;
+
+    static constexpr Value Nil() {
+        return Value(kNil);
+    }
+    static constexpr Value True() {
+        return Value(kTrue);
+    }
+    static constexpr Value False() {
+        return Value(kFalse);
+    }
+    static constexpr Value Boolean(bool value) {
+        return value ? True() : False();
+    }
+
+    // A fixnum when the value fits, otherwise a Number kept by the current
+    // ValueScope.
+    static Value Integer(int64_t value) {
+        if (value < kMinFixnum || value > kMaxFixnum) {
+            return BoxedInteger(value);
+        }
+        return Value((static_cast<uint64_t>(value) << 1) | 1);
+    }
+
+    // Borrows object, which must stay alive while the Value is used.
+    static Value FromObject(const Ref<Object>& object);
+
+    // Same, but the current ValueScope keeps a reference to object.
+    static Value Own(Ref<Object> object);
+
+    bool IsNil() const {
+        return bits_ == kNil;
+    }
+    bool IsTrue() const {
+        return bits_ == kTrue;
+    }
+    bool IsFalse() const {
+        return bits_ == kFalse;
+    }
+    bool IsBoolean() const {
+        return IsTrue() || IsFalse();
+    }
+    bool IsFixnum() const {
+        return bits_ & 1;
+    }
+    bool IsHeap() const {
+        return (bits_ & 7) == 0;
+    }
+
+    // Null unless IsHeap().
+    Object* GetObject() const {
+        return IsHeap() ? reinterpret_cast<Object*>(bits_) : nullptr;
+    }
+
+    // A fixnum or a heap Number.
+    bool IsInteger() const {
+        return IsFixnum() || IsHeapType(kNumberType);
+    }
+
+    // Throws RuntimeError unless IsInteger().
+    int64_t GetInteger() const {
+        if (IsFixnum()) {
+            return static_cast<int64_t>(bits_) >> 1;
+        }
+        return GetHeapInteger();
+    }
+
+    // A heap Symbol or a boolean; #t and #f are read as symbols.
+    bool IsSymbol() const {
+        return IsBoolean() || IsHeapType(kSymbolType);
+    }
+    bool IsSymbolNamed(std::string_view name) const;
+
+    // Null unless the value is a cell.
+    Cell* AsCell() const;
+
+    // The value as an object: fixnums become a Number, shared when small,
+    // booleans are the shared BooleanObject, '() is nullptr, and heap objects
+    // are shared.
+    Ref<Object> ToObject() const;
+
+    bool operator==(const Value&) const = default;
+
+private:
+    // Only the tags the inline checks need; the full enum is in object.h.
+    static constexpr uint8_t kNumberType = 0;
+    static constexpr uint8_t kSymbolType = 1;
+
+    static constexpr uint64_t kNil = 0b0010;
+    static constexpr uint64_t kFalse = 0b0110;
+    static constexpr uint64_t kTrue = 0b1010;
+
+    explicit constexpr Value(uint64_t bits) : bits_(bits){};
+
+    static Value BoxedInteger(int64_t value);
+    bool IsHeapType(uint8_t type) const;
+    int64_t GetHeapInteger() const;
+
+    uint64_t bits_ = kNil;
+};
+
+// When a ValueScope collects. A minor collection runs once nursery_size
+// objects were kept since the last one. A full collection follows when the
+// old space holds threshold objects; afterwards the threshold becomes the
+// survivors times growth_factor, but never less than initial_threshold.
+struct GcOptions {
+    size_t initial_threshold = 4096;
+    double growth_factor = 2.0;
+    size_t nursery_size = 1024;
+};
+
+struct GcStats {
+    // Full collections; minor ones are counted apart.
+    size_t collections = 0;
+    size_t minor_collections = 0;
+    // Objects the sweeps let go of, and nursery objects that survived.
+    size_t objects_released = 0;
+    size_t objects_promoted = 0;
+    // Over both kinds of collection.
+    std::chrono::nanoseconds total_pause{0};
+    std::chrono::nanoseconds max_pause{0};
+    std::chrono::nanoseconds max_minor_pause{0};
+};
+
+class ValueScope;
+
+// Finds the live objects of a ValueScope. Objects report what they refer to
+// through Object::Trace.
+class GcMarker {
+public:
+    void Mark(Value value);
+    void Mark(const Ref<Object>& object);
+
+private:
+    friend class ValueScope;
+
+    void Mark(Object* object);
+
+    std::vector<Object*> pending_;
+    // A minor collection neither marks nor follows old objects.
+    bool young_only_ = false;
+};
+
+// Values held outside the heap that a collection has to keep alive: the
+// evaluator's result stack and the operations it is running. Registers with
+// the current ValueScope for as long as it lives.
+class ValueRoots {
+public:
+    ValueRoots();
+    ~ValueRoots();
+
+    ValueRoots(const ValueRoots&) = delete;
+    ValueRoots& operator=(const ValueRoots&) = delete;
+
+    std::vector<Value> values;
+    std::vector<Ref<Object>> operations;
+
+private:
+    friend class ValueScope;
+
+    ValueScope* scope_;
+    ValueRoots* next_;
+};
+
+// The heap of one evaluation: owns every object kept while it is the current
+// scope on this thread, and hands them back when it ends. Scopes nest;
+// Value::Own and big integers go to the innermost one, and making them
+// without any scope is an error.
+//
+// Objects are not bump-allocated and never move. Allocate takes a slot from
+// this thread's SlabPool like any other Number, Symbol or Cell, and the slot
+// of a released object is reused by the next allocation. What makes the
+// scope generational is bookkeeping: Keep appends a reference to the nursery
+// list, and a bit in the object header says whether it was promoted to the
+// old list.
+//
+// Most kept objects are garbage by the next step of the evaluation. The
+// evaluator calls Safepoint() between steps; once the nursery list is full, a
+// minor collection marks from the registered ValueRoots and from the
+// remembered old objects, without following old objects, moves the nursery
+// references it reached to the old list and drops the rest. When the old list
+// reaches its threshold, a full mark-sweep follows. Objects are immutable
+// once built, except that (list ...) appends to its result in place with
+// Cell::SetSecond; that is the only write the barrier sees an old object make
+// to a nursery one.
+//
+// This is scoped release of evaluation temporaries, not a collector for the
+// whole object heap. A sweep only drops the scope's own reference, and
+// references between objects are still counted, so an object some live
+// object points to survives a sweep even when the mark phase never looked
+// at it; the mark phase only has to be precise about what is held as a
+// Value. Objects made by the reader, the parse cache, a ParseArena or a
+// FlatAst never belong to a scope, and a cycle of counted references is
+// never released. The language has no mutation yet, so no cycle can form;
+// set-car! or closures would need the references between objects to move
+// into the collector first.
+//
+// The host sets the growth policy and reads the pause statistics through
+// Interpreter::SetGcOptions and Interpreter::GetGcStats.
+class ValueScope {
+public:
+    explicit ValueScope(const GcOptions& options = {}, GcStats* stats = nullptr);
+    ~ValueScope();
+
+    ValueScope(const ValueScope&) = delete;
+    ValueScope& operator=(const ValueScope&) = delete;
+
+    static ValueScope* Current();
+
+    // Creates a T for the evaluator. Only what is passed to Value::Own is
+    // kept; anything else must be referenced by an object that is.
+    template <class T, class... Args>
+    static Ref<Object> Allocate(Args&&... args) {
+        return Ref<Object>(SlabPool::New<T>(std::forward<Args>(args)...));
+    }
+
+    void Keep(Ref<Object> object);
+
+    // The slow path of the write barrier: holder, an old object, now refers
+    // to a nursery object.
+    void Remember(Object* holder);
+
+    // Every Value the caller holds must be in a ValueRoots.
+    void Safepoint() {
+        if (nursery_.size() >= options_.nursery_size) {
+            CollectNursery();
+        }
+    }
+    void CollectNursery();
+    void Collect();
+
+    size_t Size() const {
+        return old_.size() + nursery_.size();
+    }
+
+private:
+    friend class ValueRoots;
+
+    void MarkRoots(GcMarker& marker) const;
+    // Appends the marked objects to survivors as old objects and lets go of
+    // the rest. Returns how many were let go of.
+    static size_t Sweep(std::vector<Ref<Object>>& objects, std::vector<Ref<Object>>& survivors);
+    void FinishCollection(std::chrono::steady_clock::time_point start, size_t released,
+                          bool minor);
+
+    std::vector<Ref<Object>> old_;
+    std::vector<Ref<Object>> nursery_;
+    std::vector<Object*> remembered_;
+    ValueRoots* roots_ = nullptr;
+    GcOptions options_;
+    GcStats* stats_;
+    size_t threshold_;
+    ValueScope* previous_;
+};